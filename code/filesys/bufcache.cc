@@ -0,0 +1,771 @@
+// bufcache.cc
+//	Routines to manage the buffer cache.  See bufcache.h.
+//
+//	One lock protects the whole cache, but it is never held across
+//	disk I/O: a buffer being read or written is marked busy instead,
+//	and anyone else who wants it waits on "ioDone".  So a hit never
+//	waits behind somebody else's miss.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "main.h"
+#include "bufcache.h"
+#include "synchdisk.h"
+#include "journal.h"
+#include "synch.h"
+
+//----------------------------------------------------------------------
+// BufferKey, HashSector
+// 	What the hash table needs to know about buffers and sectors.
+//----------------------------------------------------------------------
+
+static int
+BufferKey(CacheBuffer *buf)
+{
+    return buf->sector;
+}
+
+static unsigned
+HashSector(int sector)
+{
+    return (unsigned) sector;
+}
+
+//----------------------------------------------------------------------
+// CacheFlusher
+// 	Start the flusher thread.  Needed because Fork won't call a
+//	member function.
+//----------------------------------------------------------------------
+
+static void
+CacheFlusher(BufferCache *cache)
+{
+    cache->Flusher();
+}
+
+//----------------------------------------------------------------------
+// CacheWorker
+// 	Start the thread that does read-ahead and write-behind.
+//----------------------------------------------------------------------
+
+static void
+CacheWorker(BufferCache *cache)
+{
+    cache->Worker();
+}
+
+//----------------------------------------------------------------------
+// CacheQueue::Append, CacheQueue::Remove
+// 	Link "buf" in at the tail, or unlink it from wherever it is.
+//----------------------------------------------------------------------
+
+void
+CacheQueue::Append(CacheBuffer *buf)
+{
+    buf->prev = tail;
+    buf->next = NULL;
+    if (tail == NULL)
+	head = buf;
+    else
+	tail->next = buf;
+    tail = buf;
+    count++;
+}
+
+void
+CacheQueue::Remove(CacheBuffer *buf)
+{
+    if (buf->prev == NULL)
+	head = buf->next;
+    else
+	buf->prev->next = buf->next;
+    if (buf->next == NULL)
+	tail = buf->prev;
+    else
+	buf->next->prev = buf->prev;
+    buf->prev = buf->next = NULL;
+    count--;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::BufferCache
+// 	Start with every buffer empty, on the probation queue, so that
+//	they are the first to be used.
+//
+//	"synchDisk" -- where the sectors come from
+//----------------------------------------------------------------------
+
+BufferCache::BufferCache(SynchDisk *synchDisk)
+{
+    disk = synchDisk;
+    journal = NULL;
+    table = new HashTable<int, CacheBuffer *>(BufferKey, HashSector);
+    lock = new Lock("buffer cache lock");
+    ioDone = new Condition("buffer cache I/O");
+    numDirty = 0;
+    numAhead = 0;
+    flusherRunning = FALSE;
+    pending = new List<CacheBuffer *>;
+    workerRunning = FALSE;
+    for (int i = 0; i < NumCacheBuffers; i++) {
+	CacheBuffer *buf = &buffers[i];
+
+	buf->sector = -1;
+	buf->valid = buf->dirty = buf->busy = buf->hot = FALSE;
+	buf->ahead = FALSE;
+	probation.Append(buf);
+    }
+}
+
+//----------------------------------------------------------------------
+// BufferCache::~BufferCache
+// 	Nachos is halting.  Whatever is still dirty is lost, as it would
+//	be on a real machine that lost power; call Sync first to keep it.
+//----------------------------------------------------------------------
+
+BufferCache::~BufferCache()
+{
+    for (int i = 0; i < NumCacheBuffers; i++) {
+	if (buffers[i].sector >= 0)
+	    table->Remove(buffers[i].sector);
+    }
+    while (!pending->IsEmpty())
+	(void) pending->RemoveFront();
+    delete pending;
+    delete table;
+    delete lock;
+    delete ioDone;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadSector
+// 	Copy the contents of "sector" into "data", reading it from disk
+//	only if it is not cached.
+//----------------------------------------------------------------------
+
+void
+BufferCache::ReadSector(int sector, char *data)
+{
+    CacheBuffer *buf;
+
+    lock->Acquire();
+    buf = Find(sector, TRUE);
+    bcopy(buf->data, data, SectorSize);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteSector
+// 	Replace the contents of "sector" with "data".  The whole sector
+//	is overwritten, so a miss does not need to read it first.  The
+//	disk is not written until later.
+//
+//	If the journal takes the write, the buffer stays clean; if not,
+//	the journal must forget any older image of the sector.  Either
+//	way it is told before we take the lock, since it may do disk
+//	I/O.
+//----------------------------------------------------------------------
+
+void
+BufferCache::WriteSector(int sector, char *data)
+{
+    CacheBuffer *buf;
+    bool logged = FALSE;
+
+    if (journal != NULL) {
+	logged = journal->Log(sector, data);
+	if (!logged)
+	    journal->Revoke(sector);
+    }
+    lock->Acquire();
+    buf = Find(sector, FALSE);
+    bcopy(data, buf->data, SectorSize);
+    if (logged)
+	MarkClean(buf);
+    else
+	MarkDirty(buf);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WritePart
+// 	Replace "count" bytes of "sector", starting "offset" bytes in,
+//	with "data".  The rest of the sector is read in first, on a
+//	miss; the change is made to the cached copy, and goes to disk
+//	later, as for WriteSector.
+//
+//	The journal needs whole sectors, so in a journaled operation
+//	the sector is patched in a copy and written whole.
+//----------------------------------------------------------------------
+
+void
+BufferCache::WritePart(int sector, int offset, int count, char *data)
+{
+    CacheBuffer *buf;
+
+    ASSERT(offset >= 0 && count >= 0 && offset + count <= SectorSize);
+    if (journal != NULL) {
+	if (journal->InOperation()) {
+	    char image[SectorSize];
+
+	    ReadSector(sector, image);
+	    bcopy(data, &image[offset], count);
+	    WriteSector(sector, image);
+	    return;
+	}
+	journal->Revoke(sector);
+    }
+    lock->Acquire();
+    buf = Find(sector, TRUE);
+    bcopy(data, &buf->data[offset], count);
+    MarkDirty(buf);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadSectors
+// 	Copy the contents of "count" sectors into "data", one after the
+//	other.
+//
+//	"sectors" -- which sectors, in the order they go in "data"
+//	"data" -- count * SectorSize bytes
+//----------------------------------------------------------------------
+
+void
+BufferCache::ReadSectors(int *sectors, int count, char *data)
+{
+    ReadBytes(sectors, count, 0, count * SectorSize, data);
+}
+
+//----------------------------------------------------------------------
+// CopyPart
+// 	Copy whatever part of the "index"th sector of a read falls in
+//	the "numBytes" bytes starting "offset" bytes into the sectors,
+//	from the sector's buffer to where it goes in "data".
+//----------------------------------------------------------------------
+
+static void
+CopyPart(char *sectorData, int index, int offset, int numBytes, char *data)
+{
+    int from = max(offset, index * SectorSize);
+    int to = min(offset + numBytes, (index + 1) * SectorSize);
+
+    if (from < to)
+	bcopy(&sectorData[from - index * SectorSize], &data[from - offset],
+								to - from);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadBytes
+// 	Read "count" sectors, one after the other, and copy "numBytes"
+//	bytes of them, starting "offset" bytes into the first, into
+//	"data".  The sectors that are not cached are read from disk
+//	together, so that runs of consecutive sectors cost one disk
+//	request each, even if the bytes wanted begin or end part way
+//	through a sector.
+//
+//	Sectors are claimed CacheMaxBatch at a time, without waiting
+//	for other threads' I/O, since we hold the ones we have already
+//	claimed busy; any we could not claim are read one at a time
+//	afterwards.
+//
+//	"sectors" -- which sectors, in order
+//	"data" -- "numBytes" bytes
+//----------------------------------------------------------------------
+
+void
+BufferCache::ReadBytes(int *sectors, int count, int offset, int numBytes,
+								char *data)
+{
+    CacheBuffer *missBuf[CacheMaxBatch];
+    int missSector[CacheMaxBatch];
+    char *missData[CacheMaxBatch];
+    int missAt[CacheMaxBatch];
+    bool deferred[CacheMaxBatch];
+    CacheBuffer *buf;
+    int start, n, i, k;
+
+    lock->Acquire();
+    for (start = 0; start < count; start += n) {
+	n = min(count - start, CacheMaxBatch);
+	k = 0;
+	for (i = 0; i < n; i++) {
+	    buf = Claim(sectors[start + i], FALSE);
+	    deferred[i] = (buf == NULL);
+	    if (buf == NULL)
+		continue;
+	    if (buf->valid) {		// hit: copy it now, before a later
+					// Claim can replace it
+		CopyPart(buf->data, start + i, offset, numBytes, data);
+	    } else {
+		missBuf[k] = buf;
+		missSector[k] = sectors[start + i];
+		missData[k] = buf->data;
+		missAt[k] = start + i;
+		k++;
+	    }
+	}
+	if (k > 0) {
+	    int m = 0;
+
+	    lock->Release();
+	    for (i = 0; i < k; i++) {	// the journal's take precedence
+		if (journal == NULL
+			|| !journal->Read(missSector[i], missData[i])) {
+		    missSector[m] = missSector[i];
+		    missData[m] = missData[i];
+		    m++;
+		}
+	    }
+	    if (m > 0)
+		disk->ReadScatter(missSector, missData, m);
+	    lock->Acquire();
+	    for (i = 0; i < k; i++) {
+		CopyPart(missBuf[i]->data, missAt[i], offset, numBytes, data);
+		Filled(missBuf[i]);
+	    }
+	}
+	for (i = 0; i < n; i++) {
+	    if (deferred[i]) {
+		buf = Find(sectors[start + i], TRUE);
+		CopyPart(buf->data, start + i, offset, numBytes, data);
+	    }
+	}
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadAhead
+// 	Start reading in whichever of "count" sectors are not cached,
+//	and return without waiting.  Anyone who wants one of them before
+//	it arrives waits for it as for any other miss.
+//
+//	Read-ahead is only a hint, so it gives up rather than wait: at
+//	the first sector it finds no free buffer for.
+//----------------------------------------------------------------------
+
+void
+BufferCache::ReadAhead(int *sectors, int count)
+{
+    CacheBuffer *buf;
+
+    lock->Acquire();
+    for (int i = 0; i < count; i++) {
+	if (table->IsInTable(sectors[i]))
+	    continue;			// cached, or on its way
+	buf = Claim(sectors[i], FALSE);
+	if (buf == NULL)
+	    break;
+	if (buf->valid)			// someone else read it in while
+	    continue;			// Claim wrote out a victim
+	buf->ahead = TRUE;
+	numAhead++;
+	pending->Append(buf);
+    }
+    StartWorker();
+    lock->Release();
+    kernel->currentThread->Yield();	// let the worker get the disk
+					// started before we go on
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteBehind
+// 	Start writing whichever of "count" sectors are cached and dirty,
+//	and return without waiting.  The caller expects not to change
+//	them again soon; if it does, it waits until they are written.
+//----------------------------------------------------------------------
+
+void
+BufferCache::WriteBehind(int *sectors, int count)
+{
+    CacheBuffer *buf;
+
+    lock->Acquire();
+    for (int i = 0; i < count; i++) {
+	if (table->Find(sectors[i], &buf) && buf->dirty && !buf->busy) {
+	    buf->busy = TRUE;
+	    pending->Append(buf);
+	}
+    }
+    StartWorker();
+    lock->Release();
+    kernel->currentThread->Yield();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Sync
+// 	Write every sector that was dirty when we were called back to
+//	disk.  Returns once they are all written.
+//
+//	All the dirty buffers nobody is using go to the disk in one
+//	gather write, in sector order, so that consecutive sectors are
+//	written as a run; then we wait for the rest.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Sync()
+{
+    CacheBuffer *batch[NumCacheBuffers];
+    int sectors[NumCacheBuffers];
+    char *data[NumCacheBuffers];
+    CacheBuffer *buf;
+    int i, j, k = 0;
+
+    lock->Acquire();
+    for (i = 0; i < NumCacheBuffers; i++) {
+	buf = &buffers[i];
+	if (buf->dirty && !buf->busy) {	// insertion sort by sector
+	    buf->busy = TRUE;
+	    for (j = k; j > 0 && batch[j - 1]->sector > buf->sector; j--)
+		batch[j] = batch[j - 1];
+	    batch[j] = buf;
+	    k++;
+	}
+    }
+    if (k > 0) {
+	for (i = 0; i < k; i++) {
+	    sectors[i] = batch[i]->sector;
+	    data[i] = batch[i]->data;
+	}
+	DEBUG(dbgFile, "Cache writing back " << k << " sectors");
+	lock->Release();
+	disk->WriteGather(sectors, data, k);
+	lock->Acquire();
+	for (i = 0; i < k; i++) {
+	    batch[i]->busy = FALSE;
+	    batch[i]->dirty = FALSE;
+	}
+	numDirty -= k;
+	ioDone->Broadcast(lock);
+    }
+
+    for (i = 0; i < NumCacheBuffers; i++) {
+	CacheBuffer *buf = &buffers[i];
+
+	while (buf->busy)
+	    ioDone->Wait(lock);
+	if (buf->dirty)
+	    WriteOut(buf);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Flusher
+// 	Write dirty sectors back every CacheFlushInterval timer
+//	interrupts, until a pass leaves nothing dirty.  The thread then
+//	finishes, so that it doesn't keep an otherwise idle machine
+//	running; MarkDirty starts a new one when it is needed again.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Flusher()
+{
+    lock->Acquire();
+    while (numDirty > 0) {
+	lock->Release();
+	kernel->alarm->WaitUntil(CacheFlushInterval);
+	Sync();
+	lock->Acquire();
+    }
+    flusherRunning = FALSE;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Worker
+// 	Do the I/O that ReadAhead and WriteBehind started, until there
+//	is none left; then finish, as the flusher does.  The buffers are
+//	taken CacheMaxBatch at a time, and each batch costs one scatter
+//	read and one gather write, so consecutive sectors go to or from
+//	the disk as a run.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Worker()
+{
+    CacheBuffer *batch[CacheMaxBatch];
+    int readSector[CacheMaxBatch], writeSector[CacheMaxBatch];
+    char *readData[CacheMaxBatch], *writeData[CacheMaxBatch];
+    int i, k, r, w;
+
+    lock->Acquire();
+    while (!pending->IsEmpty()) {
+	w = 0;
+	for (k = 0; k < CacheMaxBatch && !pending->IsEmpty(); k++) {
+	    batch[k] = pending->RemoveFront();
+	    if (batch[k]->valid) {	// dirty, to be written
+		writeSector[w] = batch[k]->sector;
+		writeData[w++] = batch[k]->data;
+	    }
+	}
+	DEBUG(dbgFile, "Cache reading ahead " << k - w << ", writing behind " << w << " sectors");
+	lock->Release();
+	r = 0;
+	for (i = 0; i < k; i++) {	// the journal's take precedence
+	    if (!batch[i]->valid && (journal == NULL
+			|| !journal->Read(batch[i]->sector, batch[i]->data))) {
+		readSector[r] = batch[i]->sector;
+		readData[r++] = batch[i]->data;
+	    }
+	}
+	if (r > 0)
+	    disk->ReadScatter(readSector, readData, r);
+	if (w > 0)
+	    disk->WriteGather(writeSector, writeData, w);
+	lock->Acquire();
+	for (i = 0; i < k; i++) {
+	    if (batch[i]->valid) {
+		batch[i]->busy = FALSE;
+		batch[i]->dirty = FALSE;
+		numDirty--;
+	    } else {
+		batch[i]->valid = TRUE;
+		batch[i]->busy = FALSE;
+	    }
+	}
+	ioDone->Broadcast(lock);
+    }
+    workerRunning = FALSE;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Find
+// 	Return the buffer holding "sector".  Called, and returns, with
+//	the lock held; the buffer is not busy.  May give up the lock
+//	while doing disk I/O.
+//
+//	"fill" -- read the sector in on a miss; otherwise the caller is
+//		about to overwrite all of it
+//----------------------------------------------------------------------
+
+CacheBuffer *
+BufferCache::Find(int sector, bool fill)
+{
+    CacheBuffer *buf = Claim(sector, TRUE);
+
+    if (!buf->valid) {
+	if (fill) {
+	    lock->Release();
+	    if (journal == NULL || !journal->Read(sector, buf->data))
+		disk->ReadSector(sector, buf->data);
+	    lock->Acquire();
+	}
+	Filled(buf);
+    }
+    return buf;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Claim
+// 	Look "sector" up.  On a hit, return its buffer, which is not
+//	busy.  On a miss, take over the least valuable buffer for it,
+//	and return that marked busy and not valid; the caller must fill
+//	it in and call Filled.  Called with the lock held; may give it
+//	up while writing a dirty buffer back.
+//
+//	"wait" -- if FALSE, return NULL rather than wait for another
+//		thread's I/O
+//----------------------------------------------------------------------
+
+CacheBuffer *
+BufferCache::Claim(int sector, bool wait)
+{
+    CacheBuffer *buf;
+
+    for (;;) {
+	if (table->Find(sector, &buf)) {
+	    if (buf->busy) {		// somebody else's miss, or a write
+		if (!wait)		// back; look again when it's done
+		    return NULL;
+		ioDone->Wait(lock);
+		continue;
+	    }
+	    kernel->stats->numCacheHits++;
+	    if (buf->ahead) {		// its first use: as if it had
+		buf->ahead = FALSE;	// just been read in
+		numAhead--;
+		probation.Remove(buf);
+		probation.Append(buf);
+	    } else {
+		Touch(buf);
+	    }
+	    return buf;
+	}
+	buf = Victim();
+	if (buf == NULL) {
+	    if (!wait)
+		return NULL;
+	    ioDone->Wait(lock);
+	    continue;
+	}
+	if (buf->dirty) {		// while it is written out, someone
+	    WriteOut(buf);		// else may cache "sector", or grab
+	    continue;			// this buffer; so start over
+	}
+	break;
+    }
+
+    kernel->stats->numCacheMisses++;
+    DEBUG(dbgFile, "Cache miss on sector " << sector << ", replacing " << buf->sector);
+    if (buf->sector >= 0)
+	table->Remove(buf->sector);
+    if (buf->ahead)
+	numAhead--;
+    if (buf->hot)
+	hotQueue.Remove(buf);
+    else
+	probation.Remove(buf);
+    buf->sector = sector;
+    buf->valid = buf->hot = buf->ahead = FALSE;
+    buf->busy = TRUE;
+    table->Insert(buf);
+    probation.Append(buf);
+    return buf;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Filled
+// 	"buf", returned busy by Claim, now holds its sector.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Filled(CacheBuffer *buf)
+{
+    buf->valid = TRUE;
+    buf->busy = FALSE;
+    ioDone->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Victim
+// 	Pick the buffer to replace: the oldest on the probation queue
+//	if it is over its share, otherwise the least recently used on
+//	the main queue.  Busy buffers are skipped, and so are ones read
+//	ahead and not used yet, unless there is nothing else; nor do
+//	they count against the probation queue's share.
+//----------------------------------------------------------------------
+
+CacheBuffer *
+BufferCache::Victim()
+{
+    CacheQueue *order[2];
+    CacheBuffer *buf, *unused = NULL;
+
+    if (probation.NumInQueue() - numAhead > CacheProbation ||
+		hotQueue.NumInQueue() == 0) {
+	order[0] = &probation;
+	order[1] = &hotQueue;
+    } else {
+	order[0] = &hotQueue;
+	order[1] = &probation;
+    }
+    for (int i = 0; i < 2; i++) {
+	for (buf = order[i]->Front(); buf != NULL; buf = buf->next) {
+	    if (buf->busy)
+		continue;
+	    if (!buf->ahead)
+		return buf;
+	    if (unused == NULL)
+		unused = buf;
+	}
+    }
+    return unused;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Touch
+// 	"buf" was used again.  Move it to the most recently used end of
+//	the main queue, promoting it off probation if need be.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Touch(CacheBuffer *buf)
+{
+    if (buf->hot) {
+	hotQueue.Remove(buf);
+    } else {
+	probation.Remove(buf);
+	buf->hot = TRUE;
+    }
+    hotQueue.Append(buf);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::MarkDirty
+// 	"buf" has changed since it was last written.  Make sure there
+//	is a flusher thread to write it out.
+//----------------------------------------------------------------------
+
+void
+BufferCache::MarkDirty(CacheBuffer *buf)
+{
+    if (buf->dirty)
+	return;
+    buf->dirty = TRUE;
+    numDirty++;
+    if (!flusherRunning) {
+	Thread *t = new Thread("cache flusher");
+
+	flusherRunning = TRUE;
+	t->Fork((VoidFunctionPtr) CacheFlusher, (void *) this);
+    }
+}
+
+//----------------------------------------------------------------------
+// BufferCache::MarkClean
+// 	The journal now has the contents of "buf", and will get them to
+//	disk; anything written to the buffer before need not be.
+//----------------------------------------------------------------------
+
+void
+BufferCache::MarkClean(CacheBuffer *buf)
+{
+    if (buf->dirty) {
+	buf->dirty = FALSE;
+	numDirty--;
+    }
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteOut
+// 	Write "buf" to disk.  Called with the lock held; gives it up
+//	while the disk is busy.
+//----------------------------------------------------------------------
+
+void
+BufferCache::WriteOut(CacheBuffer *buf)
+{
+    ASSERT(buf->dirty && !buf->busy);
+    DEBUG(dbgFile, "Cache writing back sector " << buf->sector);
+    buf->busy = TRUE;
+    lock->Release();
+    disk->WriteSector(buf->sector, buf->data);
+    lock->Acquire();
+    buf->busy = FALSE;
+    buf->dirty = FALSE;
+    numDirty--;
+    ioDone->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::StartWorker
+// 	Make sure there is a worker thread, if there is I/O for it to do.
+//	Called with the lock held.
+//----------------------------------------------------------------------
+
+void
+BufferCache::StartWorker()
+{
+    if (!pending->IsEmpty() && !workerRunning) {
+	Thread *t = new Thread("cache worker");
+
+	workerRunning = TRUE;
+	t->Fork((VoidFunctionPtr) CacheWorker, (void *) this);
+    }
+}
@@ -0,0 +1,164 @@
+// bufcache.h
+//	Data structures for the buffer cache: copies of recently used
+//	disk sectors, kept in memory between the file system and the
+//	synchronous disk.
+//
+//	Every sector the file system reads or writes goes through the
+//	cache.  A read that hits is a copy; a write only updates the
+//	cached copy and marks it dirty.  Dirty sectors reach the disk
+//	when they are evicted, when a flusher thread gets around to
+//	them (every CacheFlushInterval timer interrupts, for as long as
+//	anything is dirty), or on an explicit Sync.
+//
+//	Replacement is the simplified 2Q of Johnson and Shasha: a
+//	sector read in for the first time goes on a probation queue,
+//	and only moves to the main LRU queue if it is used again while
+//	still there.  A long sequential scan then recycles the probation
+//	buffers among itself, instead of flushing out the directory,
+//	the free map and the file headers.
+//
+//	Reads and writes can also be started without waiting for them:
+//	ReadAhead fetches sectors a caller expects to want soon, and
+//	WriteBehind pushes out dirty sectors a caller is done with, in
+//	one disk request per run.  A separate thread does the I/O, so
+//	the caller carries on meanwhile.  A sector read ahead stays on
+//	probation until it has been used twice, like any other.
+//
+//	Once the file system has a journal, sectors written during a
+//	journaled operation are handed to it instead: the cached copy is
+//	updated but left clean, and the journal sees that the sector
+//	gets home.  A miss on such a sector is served from the journal.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef BUFCACHE_H
+#define BUFCACHE_H
+
+#include "copyright.h"
+#include "disk.h"
+#include "hash.h"
+#include "list.h"
+
+class SynchDisk;
+class Journal;
+class Lock;
+class Condition;
+
+const int NumCacheBuffers = 64;		// sectors held in memory
+const int CacheProbation = NumCacheBuffers / 4;
+					// the probation queue gives up a
+					// buffer first once it holds more
+					// than this many
+const int CacheFlushInterval = 10;	// timer interrupts between flushes
+const int CacheMaxBatch = CacheProbation;
+					// most sectors ReadSectors holds
+					// busy at once
+
+// One cached sector.  "busy" is set while the sector is being read
+// into or written out of the buffer; nobody else may touch the data
+// until it is cleared.
+
+class CacheBuffer {
+  public:
+    int sector;			// which sector; -1 if never used
+    bool valid;			// data holds the sector's contents
+    bool dirty;			// data is newer than the disk
+    bool busy;			// disk I/O in progress
+    bool hot;			// on the main queue, not probation
+    bool ahead;			// read ahead, and not used since
+    CacheBuffer *prev;		// neighbours on its queue; the head
+    CacheBuffer *next;		//  is the next to be replaced
+    char data[SectorSize];
+};
+
+// A queue of buffers, least recently used first.  Unlike List, any
+// buffer can be taken out in constant time.
+
+class CacheQueue {
+  public:
+    CacheQueue() { head = tail = NULL; count = 0; }
+
+    void Append(CacheBuffer *buf);	// put at the tail
+    void Remove(CacheBuffer *buf);	// take out of the queue
+    CacheBuffer *Front() { return head; }
+    int NumInQueue() { return count; }
+
+  private:
+    CacheBuffer *head;
+    CacheBuffer *tail;
+    int count;
+};
+
+// The cache itself.  Sectors are read and written whole; "data" is
+// always SectorSize bytes.
+
+class BufferCache {
+  public:
+    BufferCache(SynchDisk *synchDisk);
+    ~BufferCache();
+
+    void ReadSector(int sector, char *data);
+    void WriteSector(int sector, char *data);
+					// like SynchDisk's, but only go to
+					// the disk on a read miss
+    void ReadSectors(int *sectors, int count, char *data);
+					// read several sectors, with one
+					// disk request per run of misses
+    void ReadBytes(int *sectors, int count, int offset, int numBytes,
+							char *data);
+					// ... but only copy "numBytes" of
+					// them, from "offset" on
+    void WritePart(int sector, int offset, int count, char *data);
+					// write "count" bytes of "sector",
+					// from "offset" on
+    void ReadAhead(int *sectors, int count);
+					// start reading those of the
+					// sectors that are not cached
+    void WriteBehind(int *sectors, int count);
+					// start writing those of the
+					// sectors that are dirty
+    void Sync();			// write every dirty sector to disk
+    void UseJournal(Journal *j) { journal = j; }
+					// send writes in operations to "j"
+
+    void Flusher();			// body of the flusher thread
+    void Worker();			// body of the thread doing
+					// ReadAhead and WriteBehind
+
+  private:
+    SynchDisk *disk;
+    Journal *journal;			// NULL if there is none (yet)
+    CacheBuffer buffers[NumCacheBuffers];
+    HashTable<int, CacheBuffer *> *table;	// valid and busy buffers,
+						// by sector
+    CacheQueue probation;		// used once since read in
+    CacheQueue hotQueue;		// used again; plain LRU
+    Lock *lock;				// protects everything above
+    Condition *ioDone;			// some buffer stopped being busy
+    int numDirty;
+    int numAhead;			// buffers read ahead and not used
+    bool flusherRunning;
+    List<CacheBuffer *> *pending;	// busy buffers waiting for the
+					// worker to read or write them
+    bool workerRunning;
+
+    CacheBuffer *Find(int sector, bool fill);
+					// return the buffer for "sector",
+					// read in from disk if "fill"
+    CacheBuffer *Claim(int sector, bool wait);
+					// the buffer for "sector"; on a
+					// miss, busy and not yet read in
+    void Filled(CacheBuffer *buf);	// a claimed buffer has its data
+    CacheBuffer *Victim();		// buffer to replace; NULL if all
+					// are busy
+    void Touch(CacheBuffer *buf);	// "buf" was just used
+    void MarkDirty(CacheBuffer *buf);
+    void MarkClean(CacheBuffer *buf);	// the journal has "buf"
+    void WriteOut(CacheBuffer *buf);	// write "buf" to disk, and mark
+					// it clean
+    void StartWorker();			// make sure "pending" gets done
+};
+
+#endif // BUFCACHE_H
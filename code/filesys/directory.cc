@@ -1,179 +1,502 @@
-// directory.cc 
+// directory.cc
 //	Routines to manage a directory of file names.
 //
-//	The directory is a table of fixed length entries; each
+//	The directory is a hash table of fixed length entries; each
 //	entry represents a single file, and contains the file name,
 //	and the location of the file header on disk.  The fixed size
 //	of each directory entry means that we have the restriction
 //	of a fixed maximum size for file names.
 //
-//	The constructor initializes an empty directory of a certain size;
-//	we use ReadFrom/WriteBack to fetch the contents of the directory
-//	from disk, and to write back any modifications back to disk.
+//	The directory file is laid out in sectors:
 //
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
-//	Fixing this is one of the parts to the assignment.
+//	   sector 0		the header: depth, table size, number of
+//				entries and sectors, and the parent
+//	   sectors 1..T		the table; entry i is the sector (of the
+//				directory file) of the bucket for names
+//				whose hash ends in the bits of i
+//	   the rest		buckets, in the order they were made,
+//				and room for more
+//
+//	The file grows by doubling, so that even a big directory is
+//	only a few extents, and its file header a sector or two.
+//
+//	A bucket that has to split goes on the end of the file.  So does
+//	one that is in the way when the table has to grow by a sector;
+//	its table entries are changed to match.
+//
+//	A Directory object reads the header (depth, table size, and the
+//	entry and sector counts) when it is made, and keeps it in memory,
+//	writing it back as it changes.  The buckets and the table are
+//	read afresh each time.  So only one Directory object per file may
+//	be in use at a time: one made earlier and still in use would
+//	work from a stale header.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
 #include "utility.h"
+#include "debug.h"
 #include "filehdr.h"
 #include "directory.h"
+#include "pbitmap.h"
 #include <stdio.h>
 #include <string.h>
 
+// What the header sector, and each bucket, hold on disk.
+
+class DirectoryHeader {
+  public:
+    int depth;
+    int tableSectors;
+    int numEntries;
+    int numSectors;
+    int parent;
+};
+
+class DirectoryBucket {
+  public:
+    int depth;				// index bits its names have in common
+    DirectoryEntry entries[EntriesPerBucket];
+};
+
+//----------------------------------------------------------------------
+// HashName
+// 	Hash a file name (FNV-1a).  Only the part of the name that is
+//	stored in a directory entry counts.
+//----------------------------------------------------------------------
+
+static unsigned int
+HashName(char *name)
+{
+    unsigned int hash = 2166136261u;
+
+    for (int i = 0; i < FileNameMaxLen && name[i] != '\0'; i++) {
+	hash ^= (unsigned char) name[i];
+	hash *= 16777619;
+    }
+    return hash;
+}
+
 //----------------------------------------------------------------------
 // Directory::Directory
-// 	Initialize a directory; initially, the directory is completely
-//	empty.  If the disk is being formatted, an empty directory
-//	is all we need, but otherwise, we need to call FetchFrom in order
-//	to initialize it from disk.
+// 	Initialize a directory stored in "dirFile".  If the disk is
+//	being formatted, the file holds garbage until Format is called;
+//	otherwise, read in the header.
 //
-//	"size" is the number of entries in the directory
+//	"dirFile" -- the directory's file, which stays open as long as
+//		this object does
 //----------------------------------------------------------------------
 
-Directory::Directory(int size)
+Directory::Directory(OpenFile *dirFile)
 {
-    table = new DirectoryEntry[size];
-    tableSize = size;
-    for (int i = 0; i < tableSize; i++)
-	table[i].inUse = FALSE;
+    int buf[SectorSize / sizeof(int)];
+    DirectoryHeader *header = (DirectoryHeader *) buf;
+
+    ASSERT(sizeof(DirectoryBucket) <= SectorSize);
+    file = dirFile;
+    ReadSector(0, buf);
+    depth = header->depth;
+    tableSectors = header->tableSectors;
+    numEntries = header->numEntries;
+    numSectors = header->numSectors;
+    parent = header->parent;
 }
 
 //----------------------------------------------------------------------
 // Directory::~Directory
-// 	De-allocate directory data structure.
+// 	De-allocate directory data structure.  The file is the caller's.
 //----------------------------------------------------------------------
 
 Directory::~Directory()
-{ 
-    delete [] table;
-} 
+{
+}
 
 //----------------------------------------------------------------------
-// Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// Directory::Format
+// 	Write out an empty directory: a table with one entry, pointing
+//	at one empty bucket.
 //
-//	"file" -- file containing the directory contents
+//	"parentSector" -- file header sector of the directory this one
+//		is in
 //----------------------------------------------------------------------
 
 void
-Directory::FetchFrom(OpenFile *file)
+Directory::Format(int parentSector)
 {
-    (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    int buf[SectorSize / sizeof(int)];
+
+    ASSERT(file->Length() >= DirectoryFileSize);
+    depth = 0;
+    tableSectors = 1;
+    numEntries = 0;
+    numSectors = 3;
+    parent = parentSector;
+    WriteHeader();
+
+    bzero((char *) buf, SectorSize);
+    buf[0] = 2;				// the bucket
+    WriteSector(1, buf);
+    bzero((char *) buf, SectorSize);
+    WriteSector(2, buf);
 }
 
 //----------------------------------------------------------------------
-// Directory::WriteBack
-// 	Write any modifications to the directory back to disk
-//
-//	"file" -- file to contain the new directory contents
+// Directory::ReadSector/WriteSector
+// 	Read/write sector "index" of the directory file.
 //----------------------------------------------------------------------
 
 void
-Directory::WriteBack(OpenFile *file)
+Directory::ReadSector(int index, void *buf)
 {
-    (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    (void) file->ReadAt((char *) buf, SectorSize, index * SectorSize);
+}
+
+void
+Directory::WriteSector(int index, void *buf)
+{
+    (void) file->WriteAt((char *) buf, SectorSize, index * SectorSize);
 }
 
 //----------------------------------------------------------------------
-// Directory::FindIndex
-// 	Look up file name in directory, and return its location in the table of
-//	directory entries.  Return -1 if the name isn't in the directory.
-//
-//	"name" -- the file name to look up
+// Directory::WriteHeader
+// 	Write the header back, after a change to it.
+//----------------------------------------------------------------------
+
+void
+Directory::WriteHeader()
+{
+    int buf[SectorSize / sizeof(int)];
+    DirectoryHeader *header = (DirectoryHeader *) buf;
+
+    bzero((char *) buf, SectorSize);
+    header->depth = depth;
+    header->tableSectors = tableSectors;
+    header->numEntries = numEntries;
+    header->numSectors = numSectors;
+    header->parent = parent;
+    WriteSector(0, buf);
+}
+
+//----------------------------------------------------------------------
+// Directory::TableEntry
+// 	Return the sector of the bucket for names whose hash ends in
+//	the bits of "index".
 //----------------------------------------------------------------------
 
 int
-Directory::FindIndex(char *name)
+Directory::TableEntry(int index)
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
-	    return i;
-    return -1;		// name not in directory
+    int buf[SectorSize / sizeof(int)];
+
+    ReadSector(1 + index / TableEntriesPerSector, buf);
+    return buf[index % TableEntriesPerSector];
+}
+
+//----------------------------------------------------------------------
+// Directory::Grow
+// 	Add "count" sectors to the end of the directory.  If the file
+//	has no room left, double it, or if the disk is too full for
+//	that, add just what is needed.  Return FALSE if the disk is full.
+//----------------------------------------------------------------------
+
+bool
+Directory::Grow(int count, PersistBitMap *freeMap)
+{
+    int room = file->Length() / SectorSize;
+
+    if (numSectors + count > room &&
+		!file->Extend(freeMap,
+			max(numSectors + count, 2 * room) * SectorSize) &&
+		!file->Extend(freeMap, (numSectors + count) * SectorSize))
+	return FALSE;
+    numSectors += count;
+    WriteHeader();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Directory::Split
+// 	Split the full bucket in sector "bucket" in two: the names that
+//	have the next bit of the hash set move to a new bucket at the
+//	end of the file, and the table entries for them are changed to
+//	point there.  Return FALSE if the directory can't grow.
+//
+//	"index" -- any table index that leads to "bucket"
+//----------------------------------------------------------------------
+
+bool
+Directory::Split(int bucket, int index, PersistBitMap *freeMap)
+{
+    int buf[SectorSize / sizeof(int)];
+    int newBuf[SectorSize / sizeof(int)];
+    int tableBuf[SectorSize / sizeof(int)];
+    DirectoryBucket *old = (DirectoryBucket *) buf;
+    DirectoryBucket *split = (DirectoryBucket *) newBuf;
+    int newBucket = numSectors;
+    int bits, i, j, loaded;
+
+    if (!Grow(1, freeMap))
+	return FALSE;
+    ReadSector(bucket, buf);
+    bits = old->depth;
+    ASSERT(bits < depth);
+    bzero((char *) newBuf, SectorSize);
+    old->depth = split->depth = bits + 1;
+    for (i = j = 0; i < EntriesPerBucket; i++) {
+	DirectoryEntry *entry = &old->entries[i];
+
+	if (entry->inUse && ((HashName(entry->name) >> bits) & 1)) {
+	    split->entries[j++] = *entry;
+	    entry->inUse = FALSE;
+	}
+    }
+    WriteSector(bucket, buf);
+    WriteSector(newBucket, newBuf);
+
+    // of the table entries that lead to "bucket" -- all those that
+    // agree with "index" in the low "bits" bits -- the ones with the
+    // next bit set now lead to the new bucket
+    loaded = -1;
+    for (i = (index & ((1 << bits) - 1)) | (1 << bits); i < (1 << depth);
+						i += (1 << (bits + 1))) {
+	int sector = 1 + i / TableEntriesPerSector;
+
+	if (sector != loaded) {
+	    if (loaded >= 0)
+		WriteSector(loaded, tableBuf);
+	    ReadSector(sector, tableBuf);
+	    loaded = sector;
+	}
+	tableBuf[i % TableEntriesPerSector] = newBucket;
+    }
+    WriteSector(loaded, tableBuf);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Directory::Double
+// 	Use one more bit of the hash to index the table, doubling it;
+//	each new entry points at the same bucket as the old entry whose
+//	index it extends.  If the table needs more sectors than it has,
+//	the buckets in the sectors following it move to the end of the
+//	file.  Return FALSE if the table can't grow.
+//----------------------------------------------------------------------
+
+bool
+Directory::Double(PersistBitMap *freeMap)
+{
+    int size = 1 << depth;
+    int need = divRoundUp(2 * size, TableEntriesPerSector);
+    int oldSectors = numSectors;
+    int tableEnd = 1 + tableSectors;
+    int moved = 0, to = 0;
+    int buf[SectorSize / sizeof(int)];
+    int *table;
+    int i, s;
+
+    if (depth == MaxDirectoryDepth)
+	return FALSE;
+    if (need > tableSectors) {
+	to = max(oldSectors, 1 + need);
+	moved = min(oldSectors, 1 + need) - tableEnd;
+	if (!Grow(to - oldSectors + moved, freeMap))
+	    return FALSE;
+    }
+
+    table = new int[max(need, tableSectors) * TableEntriesPerSector];
+    bzero((char *) table, need * TableEntriesPerSector * sizeof(int));
+    for (s = 0; s < divRoundUp(size, TableEntriesPerSector); s++)
+	ReadSector(1 + s, &table[s * TableEntriesPerSector]);
+    for (i = 0; i < size; i++)
+	table[size + i] = table[i];
+
+    for (s = tableEnd; s < tableEnd + moved; s++, to++) {
+	ReadSector(s, buf);
+	WriteSector(to, buf);
+	for (i = 0; i < 2 * size; i++)
+	    if (table[i] == s)
+		table[i] = to;
+    }
+    if (need > tableSectors)
+	tableSectors = need;
+
+    for (s = 0; s < need; s++)
+	WriteSector(1 + s, &table[s * TableEntriesPerSector]);
+    delete [] table;
+    depth++;
+    WriteHeader();
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
 // Directory::Find
 // 	Look up file name in directory, and return the disk sector number
-//	where the file's header is stored. Return -1 if the name isn't 
+//	where the file's header is stored. Return -1 if the name isn't
 //	in the directory.
 //
 //	"name" -- the file name to look up
+//	"isDir" -- if not NULL, set to whether the file is a directory
 //----------------------------------------------------------------------
 
 int
-Directory::Find(char *name)
+Directory::Find(char *name, bool *isDir)
 {
-    int i = FindIndex(name);
+    int buf[SectorSize / sizeof(int)];
+    DirectoryBucket *bucket = (DirectoryBucket *) buf;
+    int index = HashName(name) & ((1 << depth) - 1);
+
+    ReadSector(TableEntry(index), buf);
+    for (int i = 0; i < EntriesPerBucket; i++) {
+	DirectoryEntry *entry = &bucket->entries[i];
 
-    if (i != -1)
-	return table[i].sector;
-    return -1;
+        if (entry->inUse && !strncmp(entry->name, name, FileNameMaxLen)) {
+	    if (isDir != NULL)
+		*isDir = entry->isDir;
+	    return entry->sector;
+	}
+    }
+    return -1;		// name not in directory
 }
 
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return TRUE if successful;
 //	return FALSE if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+//	the directory needed to grow and couldn't.
+//
+//	If the bucket for the name is full, split it (doubling the table
+//	first if need be), and try again.
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDir" -- is the file a directory?
+//	"freeMap" -- where to get sectors if the directory grows; the
+//		caller writes it back
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(char *name, int newSector)
-{ 
-    if (FindIndex(name) != -1)
-	return FALSE;
+Directory::Add(char *name, int newSector, bool isDir,
+						PersistBitMap *freeMap)
+{
+    int buf[SectorSize / sizeof(int)];
+    DirectoryBucket *bucket = (DirectoryBucket *) buf;
+    unsigned int hash = HashName(name);
+
+    for (;;) {
+	int index = hash & ((1 << depth) - 1);
+	int sector = TableEntry(index);
+	DirectoryEntry *slot = NULL;
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen); 
-            table[i].sector = newSector;
-        return TRUE;
+	ReadSector(sector, buf);
+	for (int i = 0; i < EntriesPerBucket; i++) {
+	    DirectoryEntry *entry = &bucket->entries[i];
+
+	    if (!entry->inUse) {
+		if (slot == NULL)
+		    slot = entry;
+	    } else if (!strncmp(entry->name, name, FileNameMaxLen))
+		return FALSE;		// already there
+	}
+	if (slot != NULL) {
+	    slot->inUse = TRUE;
+	    slot->isDir = isDir;
+	    slot->sector = newSector;
+	    strncpy(slot->name, name, FileNameMaxLen);
+	    slot->name[FileNameMaxLen] = '\0';
+	    WriteSector(sector, buf);
+	    numEntries++;
+	    WriteHeader();
+	    return TRUE;
 	}
-    return FALSE;	// no space.  Fix when we have extensible files.
+	if (bucket->depth == depth && !Double(freeMap))
+	    return FALSE;
+	if (!Split(sector, index, freeMap))
+	    return FALSE;
+    }
 }
 
 //----------------------------------------------------------------------
 // Directory::Remove
 // 	Remove a file name from the directory.  Return TRUE if successful;
-//	return FALSE if the file isn't in the directory. 
+//	return FALSE if the file isn't in the directory.  Buckets are
+//	never merged again.
 //
 //	"name" -- the file name to be removed
 //----------------------------------------------------------------------
 
 bool
 Directory::Remove(char *name)
-{ 
-    int i = FindIndex(name);
+{
+    int buf[SectorSize / sizeof(int)];
+    DirectoryBucket *bucket = (DirectoryBucket *) buf;
+    int sector = TableEntry(HashName(name) & ((1 << depth) - 1));
+
+    ReadSector(sector, buf);
+    for (int i = 0; i < EntriesPerBucket; i++) {
+	DirectoryEntry *entry = &bucket->entries[i];
 
-    if (i == -1)
-	return FALSE; 		// name not in directory
-    table[i].inUse = FALSE;
-    return TRUE;	
+        if (entry->inUse && !strncmp(entry->name, name, FileNameMaxLen)) {
+	    entry->inUse = FALSE;
+	    WriteSector(sector, buf);
+	    numEntries--;
+	    WriteHeader();
+	    return TRUE;
+	}
+    }
+    return FALSE; 		// name not in directory
+}
+
+//----------------------------------------------------------------------
+// Directory::IsEmpty, Directory::Parent
+//----------------------------------------------------------------------
+
+bool
+Directory::IsEmpty()
+{
+    return numEntries == 0;
+}
+
+int
+Directory::Parent()
+{
+    return parent;
 }
 
 //----------------------------------------------------------------------
 // Directory::List
-// 	List all the file names in the directory. 
+// 	List all the file names in the directory, and (indented) the
+//	names in each directory under it.
+//
+//	"indent" -- spaces to print before each name
 //----------------------------------------------------------------------
 
 void
-Directory::List()
+Directory::List(int indent)
 {
-   for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse)
-	    printf("%s\n", table[i].name);
+    int buf[SectorSize / sizeof(int)];
+    DirectoryBucket *bucket = (DirectoryBucket *) buf;
+
+    for (int s = 1 + tableSectors; s < numSectors; s++) {
+	ReadSector(s, buf);
+	for (int i = 0; i < EntriesPerBucket; i++) {
+	    DirectoryEntry *entry = &bucket->entries[i];
+
+	    if (!entry->inUse)
+		continue;
+	    printf("%*s%s%s\n", indent, "", entry->name,
+					entry->isDir ? "/" : "");
+	    if (entry->isDir) {
+		OpenFile *subFile = new OpenFile(entry->sector);
+		Directory *sub = new Directory(subFile);
+
+		sub->List(indent + 4);
+		delete sub;
+		delete subFile;
+	    }
+	}
+    }
 }
 
 //----------------------------------------------------------------------
@@ -184,16 +507,28 @@ Directory::List()
 
 void
 Directory::Print()
-{ 
+{
+    int buf[SectorSize / sizeof(int)];
+    DirectoryBucket *bucket = (DirectoryBucket *) buf;
     FileHeader *hdr = new FileHeader;
 
-    printf("Directory contents:\n");
-    for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse) {
-	    printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
-	    hdr->FetchFrom(table[i].sector);
-	    hdr->Print();
+    printf("Directory contents: %d entries, table depth %d, %d sectors\n",
+					numEntries, depth, numSectors);
+    for (int s = 1 + tableSectors; s < numSectors; s++) {
+	ReadSector(s, buf);
+	for (int i = 0; i < EntriesPerBucket; i++) {
+	    DirectoryEntry *entry = &bucket->entries[i];
+
+	    if (!entry->inUse)
+		continue;
+	    printf("Name: %s, Sector: %d%s\n", entry->name, entry->sector,
+					entry->isDir ? ", directory" : "");
+	    if (!entry->isDir) {
+		hdr->FetchFrom(entry->sector);
+		hdr->Print();
+	    }
 	}
+    }
     printf("\n");
     delete hdr;
 }
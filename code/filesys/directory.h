@@ -1,15 +1,16 @@
-// directory.h 
+// directory.h
 //	Data structures to manage a UNIX-like directory of file names.
-// 
+//
 //      A directory is a table of pairs: <file name, sector #>,
-//	giving the name of each file in the directory, and 
+//	giving the name of each file in the directory, and
 //	where to find its file header (the data structure describing
-//	where to find the file's data blocks) on disk.
+//	where to find the file's data blocks) on disk.  An entry may
+//	itself name a directory, so directories form a tree.
 //
 //      We assume mutual exclusion is provided by the caller.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
@@ -17,10 +18,13 @@
 #ifndef DIRECTORY_H
 #define DIRECTORY_H
 
+#include "disk.h"
 #include "openfile.h"
 
-#define FileNameMaxLen 		9	// for simplicity, we assume 
-					// file names are <= 9 characters long
+class PersistBitMap;
+
+#define FileNameMaxLen 		21	// for simplicity, we assume
+					// file names are <= 21 characters long
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
@@ -31,53 +35,89 @@
 
 class DirectoryEntry {
   public:
+    int sector;				// Location on disk to find the
+					//   FileHeader for this file
     bool inUse;				// Is this directory entry in use?
-    int sector;				// Location on disk to find the 
-					//   FileHeader for this file 
-    char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
+    bool isDir;				// Is the file a directory?
+    char name[FileNameMaxLen + 1];	// Text name for file, with +1 for
 					// the trailing '\0'
 };
 
+// A directory is stored as an extendible hash table (Fagin et al.).
+// Entries live in buckets of one sector each; a table, indexed by the
+// low "depth" bits of the hash of a name, says which bucket the name
+// belongs in.  When a bucket fills up it is split in two, and when
+// the table has no spare index bits for the split it is doubled.
+// Either way, finding a name reads one sector of the table and one
+// bucket, however many entries the directory has.
+
+#define EntriesPerBucket \
+	((int) ((SectorSize - sizeof(int)) / sizeof(DirectoryEntry)))
+#define TableEntriesPerSector	((int) (SectorSize / sizeof(int)))
+#define MaxDirectoryDepth	13	// at most 2^13 table entries, so
+					// that doubling the table fits in
+					// the journal
+#define DirectoryFileSize	(3 * SectorSize)
+					// an empty directory: a header, a
+					// one-sector table and one bucket
+
 // The following class defines a UNIX-like "directory".  Each entry in
 // the directory describes a file, and where to find it on disk.
 //
-// The directory data structure can be stored in memory, or on disk.
-// When it is on disk, it is stored as a regular Nachos file.
-//
-// The constructor initializes a directory structure in memory; the
-// FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk. 
+// The directory is kept on disk, as a regular Nachos file, and used
+// there: each operation reads and writes just the sectors of the
+// file it needs (through the buffer cache), rather than the whole
+// directory.  The file grows as entries are added.  Removing entries
+// never shrinks it.
 
 class Directory {
   public:
-    Directory(int size); 		// Initialize an empty directory
-					// with space for "size" files
-    ~Directory();			// De-allocate the directory
+    Directory(OpenFile *dirFile);	// The directory stored in "dirFile"
+    ~Directory();
 
-    void FetchFrom(OpenFile *file);  	// Init directory contents from disk
-    void WriteBack(OpenFile *file);	// Write modifications to 
-					// directory contents back to disk
+    void Format(int parentSector);	// Make "dirFile" an empty directory;
+					// it must be DirectoryFileSize long
 
-    int Find(char *name);		// Find the sector number of the 
+    int Find(char *name, bool *isDir = NULL);
+					// Find the sector number of the
 					// FileHeader for file: "name"
 
-    bool Add(char *name, int newSector);  // Add a file name into the directory
+    bool Add(char *name, int newSector, bool isDir,
+						PersistBitMap *freeMap);
+					// Add a file name into the directory,
+					// growing it from "freeMap" if need be
 
     bool Remove(char *name);		// Remove a file from the directory
 
-    void List();			// Print the names of all the files
-					//  in the directory
+    bool IsEmpty();			// Does the directory have no entries?
+    int Parent();			// Sector of the directory holding
+					//  this one (the root's is its own)
+
+    void List(int indent = 0);		// Print the names of all the files
+					//  in the directory, and in the
+					//  directories under it
     void Print();			// Verbose print of the contents
 					//  of the directory -- all the file
 					//  names and their contents.
 
   private:
-    int tableSize;			// Number of directory entries
-    DirectoryEntry *table;		// Table of pairs: 
-					// <file name, file header location> 
-
-    int FindIndex(char *name);		// Find the index into the directory 
-					//  table corresponding to "name"
+    OpenFile *file;			// Where the directory is stored
+    int depth;				// Index bits the table uses
+    int tableSectors;			// Room for the table, in sectors
+    int numEntries;
+    int numSectors;			// Sectors of the file in use
+    int parent;
+
+    void ReadSector(int index, void *buf);
+    void WriteSector(int index, void *buf);
+					// sector "index" of the directory file
+    void WriteHeader();
+    int TableEntry(int index);		// the bucket for hash index "index"
+    bool Split(int bucket, int index, PersistBitMap *freeMap);
+					// split a full bucket
+    bool Double(PersistBitMap *freeMap);	// double the table
+    bool Grow(int count, PersistBitMap *freeMap);
+					// add sectors to the end
 };
 
 #endif // DIRECTORY_H
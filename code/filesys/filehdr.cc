@@ -3,12 +3,15 @@
 //	would be called the i-node).
 //
 //	The file header is used to locate where on disk the 
-//	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	file's data is stored.  We implement this as a table of
+//	extents -- each entry in the table is a run of consecutive
+//	disk sectors holding that portion of the file data.  As many
+//	extents as fit are stored in the file header sector itself;
+//	the rest go in a chain of extent blocks after it.
+//
+//	New files are allocated in as few extents as possible, so
+//	that reading a file sequentially moves the disk head as little
+//	as possible.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -26,6 +29,48 @@
 #include "debug.h"
 #include "main.h"
 #include "filehdr.h"
+#include "bufcache.h"
+#include "pbitmap.h"
+
+// What the file header sector, and each extent block, hold on disk.
+
+class HeaderSector {
+  public:
+    int numBytes;
+    int numSectors;
+    int numExtents;
+    int firstBlock;			// first extent block; -1 if none
+    Extent extents[NumDirectExtents];
+};
+
+class ExtentBlock {
+  public:
+    int next;				// next extent block; -1 if none
+    Extent extents[ExtentsPerBlock];
+};
+
+//----------------------------------------------------------------------
+// FileHeader::FileHeader
+// 	An empty file header, to be filled in by Allocate or FetchFrom.
+//----------------------------------------------------------------------
+
+FileHeader::FileHeader()
+{
+    ASSERT(sizeof(HeaderSector) <= SectorSize);
+    ASSERT(sizeof(ExtentBlock) <= SectorSize);
+    numBytes = numSectors = numExtents = 0;
+    extents = NULL;
+    maxExtents = 0;
+    numBlocks = 0;
+    blocks = NULL;
+    cursor = cursorBase = 0;
+}
+
+FileHeader::~FileHeader()
+{
+    delete [] extents;
+    delete [] blocks;
+}
 
 //----------------------------------------------------------------------
 // FileHeader::Allocate
@@ -36,18 +81,94 @@
 //
 //	"freeMap" is the bit map of free disk sectors
 //	"fileSize" is the bit map of free disk sectors
+//	"near" is where the data would best start, such as just after
+//		the file header
 //----------------------------------------------------------------------
 
 bool
-FileHeader::Allocate(BitMap *freeMap, int fileSize)
+FileHeader::Allocate(PersistBitMap *freeMap, int fileSize, int near)
 { 
-    numBytes = fileSize;
-    numSectors  = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
+    numBytes = numSectors = 0;
+    numExtents = numBlocks = 0;
+    cursor = cursorBase = 0;
+    return Extend(freeMap, fileSize, near);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Extend
+// 	Make the file "fileSize" bytes long, allocating whatever more
+//	data sectors (and extent blocks) that takes.  New sectors go
+//	straight after the file's last extent if they are free, so a
+//	file that grows a little at a time can stay in one piece.
+//	Otherwise they go in the first free runs found from there on.
+//	Return FALSE, leaving the file as it was, if the disk is full.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"fileSize" is the new length; the file never shrinks
+//	"near" is where to look from if the file has no sectors yet
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Extend(PersistBitMap *freeMap, int fileSize, int near)
+{
+    int oldSectors = numSectors, oldExtents = numExtents;
+    int oldLast = (numExtents > 0) ? extents[numExtents - 1].length : 0;
+    int oldBlocks = numBlocks;
+    int wanted = divRoundUp(fileSize, SectorSize);
+    int left, start, length;
+
+    if (fileSize <= numBytes)
+	return TRUE;
+    if (freeMap->NumClear() < wanted - numSectors)
 	return FALSE;		// not enough space
 
-    for (int i = 0; i < numSectors; i++)
-	dataSectors[i] = freeMap->FindAndSet();
+    left = wanted - numSectors;
+    if (left > 0 && numExtents > 0) {
+	start = extents[numExtents - 1].start + extents[numExtents - 1].length;
+	for (length = 0; length < left && start + length < NumSectors &&
+			!freeMap->Test(start + length); length++)
+	    freeMap->Mark(start + length);
+	if (length > 0)
+	    AddExtent(start, length);
+	left -= length;
+	near = start + length;
+    }
+    for (; left > 0; left -= length) {
+	start = freeMap->FindRun(near % NumSectors, left, &length);
+	for (int i = 0; i < length; i++)
+	    freeMap->Mark(start + i);
+	AddExtent(start, length);
+	near = start + length;
+    }
+
+    // now we know how many extents it took, find room for the ones
+    // that don't fit in the header
+    if (numExtents > NumDirectExtents)
+	numBlocks = divRoundUp(numExtents - NumDirectExtents, ExtentsPerBlock);
+    if (freeMap->NumClear() < numBlocks - oldBlocks) {
+	numSectors = wanted;
+	for (int i = oldSectors; i < wanted; i++)
+	    freeMap->Clear(ByteToSector(i * SectorSize));
+	numSectors = oldSectors;
+	numExtents = oldExtents;
+	if (numExtents > 0)
+	    extents[numExtents - 1].length = oldLast;
+	numBlocks = oldBlocks;
+	cursor = cursorBase = 0;
+	return FALSE;
+    }
+    if (numBlocks > oldBlocks) {
+	int *old = blocks;
+
+	blocks = new int[numBlocks];
+	for (int i = 0; i < oldBlocks; i++)
+	    blocks[i] = old[i];
+	for (int i = oldBlocks; i < numBlocks; i++)
+	    blocks[i] = freeMap->FindAndSetNear(near % NumSectors);
+	delete [] old;
+    }
+    numBytes = fileSize;
+    numSectors = wanted;
     return TRUE;
 }
 
@@ -61,15 +182,24 @@ FileHeader::Allocate(BitMap *freeMap, int fileSize)
 void 
 FileHeader::Deallocate(BitMap *freeMap)
 {
-    for (int i = 0; i < numSectors; i++) {
-	ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-	freeMap->Clear((int) dataSectors[i]);
+    for (int i = 0; i < numExtents; i++) {
+	for (int j = 0; j < extents[i].length; j++) {
+	    int sector = extents[i].start + j;
+
+	    ASSERT(freeMap->Test(sector));  // ought to be marked!
+	    freeMap->Clear(sector);
+	}
+    }
+    for (int i = 0; i < numBlocks; i++) {
+	ASSERT(freeMap->Test(blocks[i]));
+	freeMap->Clear(blocks[i]);
     }
 }
 
 //----------------------------------------------------------------------
 // FileHeader::FetchFrom
-// 	Fetch contents of file header from disk. 
+// 	Fetch contents of file header from disk, along with all its
+//	extent blocks.
 //
 //	"sector" is the disk sector containing the file header
 //----------------------------------------------------------------------
@@ -77,12 +207,44 @@ FileHeader::Deallocate(BitMap *freeMap)
 void
 FileHeader::FetchFrom(int sector)
 {
-    kernel->synchDisk->ReadSector(sector, (char *)this);
+    int buf[SectorSize / sizeof(int)];
+    HeaderSector *hdr = (HeaderSector *) buf;
+    ExtentBlock *block = (ExtentBlock *) buf;
+    int i, n, next;
+
+    kernel->bufferCache->ReadSector(sector, (char *) buf);
+    numBytes = hdr->numBytes;
+    numSectors = hdr->numSectors;
+    numExtents = hdr->numExtents;
+    next = hdr->firstBlock;
+    cursor = cursorBase = 0;
+
+    delete [] extents;
+    maxExtents = numExtents;
+    extents = new Extent[maxExtents];
+    n = min(numExtents, NumDirectExtents);
+    for (i = 0; i < n; i++)
+	extents[i] = hdr->extents[i];
+
+    delete [] blocks;
+    numBlocks = 0;
+    if (numExtents > NumDirectExtents)
+	numBlocks = divRoundUp(numExtents - NumDirectExtents, ExtentsPerBlock);
+    blocks = new int[numBlocks];
+    for (int b = 0; b < numBlocks; b++) {
+	ASSERT(next >= 0);
+	blocks[b] = next;
+	kernel->bufferCache->ReadSector(next, (char *) buf);
+	for (int j = 0; j < ExtentsPerBlock && i < numExtents; j++, i++)
+	    extents[i] = block->extents[j];
+	next = block->next;
+    }
 }
 
 //----------------------------------------------------------------------
 // FileHeader::WriteBack
-// 	Write the modified contents of the file header back to disk. 
+// 	Write the modified contents of the file header back to disk,
+//	along with all its extent blocks.
 //
 //	"sector" is the disk sector to contain the file header
 //----------------------------------------------------------------------
@@ -90,7 +252,28 @@ FileHeader::FetchFrom(int sector)
 void
 FileHeader::WriteBack(int sector)
 {
-    kernel->synchDisk->WriteSector(sector, (char *)this); 
+    int buf[SectorSize / sizeof(int)];
+    HeaderSector *hdr = (HeaderSector *) buf;
+    ExtentBlock *block = (ExtentBlock *) buf;
+    int i, n;
+
+    bzero((char *) buf, SectorSize);
+    hdr->numBytes = numBytes;
+    hdr->numSectors = numSectors;
+    hdr->numExtents = numExtents;
+    hdr->firstBlock = (numBlocks > 0) ? blocks[0] : -1;
+    n = min(numExtents, NumDirectExtents);
+    for (i = 0; i < n; i++)
+	hdr->extents[i] = extents[i];
+    kernel->bufferCache->WriteSector(sector, (char *) buf); 
+
+    for (int b = 0; b < numBlocks; b++) {
+	bzero((char *) buf, SectorSize);
+	block->next = (b + 1 < numBlocks) ? blocks[b + 1] : -1;
+	for (int j = 0; j < ExtentsPerBlock && i < numExtents; j++, i++)
+	    block->extents[j] = extents[i];
+	kernel->bufferCache->WriteSector(blocks[b], (char *) buf);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -100,13 +283,54 @@ FileHeader::WriteBack(int sector)
 //	offset in the file) to a physical address (the sector where the
 //	data at the offset is stored).
 //
+//	Files are mostly read and written in order, so start looking
+//	from the extent we found last time.
+//
 //	"offset" is the location within the file of the byte in question
 //----------------------------------------------------------------------
 
 int
 FileHeader::ByteToSector(int offset)
 {
-    return(dataSectors[offset / SectorSize]);
+    int index = offset / SectorSize;
+
+    ASSERT((index >= 0) && (index < numSectors));
+    if (index < cursorBase)
+	cursor = cursorBase = 0;
+    while (index >= cursorBase + extents[cursor].length) {
+	cursorBase += extents[cursor].length;
+	cursor++;
+    }
+    return extents[cursor].start + (index - cursorBase);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::AddExtent
+// 	Append "length" sectors starting at "start" to the file's extent
+//	table, growing the table if need be.
+//----------------------------------------------------------------------
+
+void
+FileHeader::AddExtent(int start, int length)
+{
+    if (numExtents > 0 &&
+		extents[numExtents - 1].start + extents[numExtents - 1].length
+		== start) {
+	extents[numExtents - 1].length += length;
+	return;
+    }
+    if (numExtents == maxExtents) {
+	Extent *old = extents;
+
+	maxExtents = (maxExtents == 0) ? NumDirectExtents : 2 * maxExtents;
+	extents = new Extent[maxExtents];
+	for (int i = 0; i < numExtents; i++)
+	    extents[i] = old[i];
+	delete [] old;
+    }
+    extents[numExtents].start = start;
+    extents[numExtents].length = length;
+    numExtents++;
 }
 
 //----------------------------------------------------------------------
@@ -133,11 +357,12 @@ FileHeader::Print()
     char *data = new char[SectorSize];
 
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
-    for (i = 0; i < numSectors; i++)
-	printf("%d ", dataSectors[i]);
+    for (i = 0; i < numExtents; i++)
+	printf("%d-%d ", extents[i].start,
+		extents[i].start + extents[i].length - 1);
     printf("\nFile contents:\n");
     for (i = k = 0; i < numSectors; i++) {
-	kernel->synchDisk->ReadSector(dataSectors[i], data);
+	kernel->bufferCache->ReadSector(ByteToSector(i * SectorSize), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
 	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
 		printf("%c", data[j]);
@@ -17,29 +17,53 @@
 #include "disk.h"
 #include "bitmap.h"
 
-#define NumDirect 	((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize 	(NumDirect * SectorSize)
+class PersistBitMap;
+
+// A file's data lives in "extents": runs of consecutive sectors, each
+// described by its first sector and its length.  A file laid out
+// contiguously needs only one, however long it is.
+
+class Extent {
+  public:
+    int start;				// first sector of the run
+    int length;				// number of sectors in it
+};
+
+// The file header sector holds the first NumDirectExtents extents.
+// The rest, if any, go in a chain of extent blocks, each a sector
+// holding ExtentsPerBlock extents and the sector of the next block.
+
+#define NumDirectExtents \
+	((int) ((SectorSize - 4 * sizeof(int)) / sizeof(Extent)))
+#define ExtentsPerBlock	((int) ((SectorSize - sizeof(int)) / sizeof(Extent)))
+#define MaxFileSize 	(NumSectors * SectorSize)
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// The file header is organized as a table of extents.
 //
-// The file header data structure can be stored in memory or on disk.
-// When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// On disk, the file header is stored in a single sector, followed by
+// as many extent blocks as the file needs; the only limit on file
+// length is the size of the disk.  In memory, the whole extent table
+// is kept in one array, so that finding the sector for a byte of the
+// file never goes to the disk.
 //
-// There is no constructor; rather the file header can be initialized
-// by allocating blocks for the file (if it is a new file), or by
-// reading it from disk.
+// The file header can be initialized by allocating blocks for the
+// file (if it is a new file), or by reading it from disk.
 
 class FileHeader {
   public:
-    bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header, 
+    FileHeader();
+    ~FileHeader();
+
+    bool Allocate(PersistBitMap *freeMap, int fileSize, int near);
+						// Initialize a file header, 
 						//  including allocating space 
-						//  on disk for the file data
+						//  on disk for the file data,
+						//  as close to "near" as it can
+    bool Extend(PersistBitMap *freeMap, int fileSize, int near);
+						// Make the file longer,
+						//  allocating more space for it
     void Deallocate(BitMap *bitMap);  		// De-allocate this file's 
 						//  data blocks
 
@@ -59,8 +83,18 @@ class FileHeader {
   private:
     int numBytes;			// Number of bytes in the file
     int numSectors;			// Number of data sectors in the file
-    int dataSectors[NumDirect];		// Disk sector numbers for each data 
-					// block in the file
+    int numExtents;
+    Extent *extents;			// All the extents, in file order
+    int maxExtents;			// Room in "extents"
+    int numBlocks;			// Extent blocks the file has on disk
+    int *blocks;			// ... and where they are
+    int cursor;				// Extent ByteToSector last used,
+    int cursorBase;			//  and its first sector in the file
+
+    void AddExtent(int start, int length);
+					// append to the extent table,
+					// merging with the last extent if
+					// they are adjacent
 };
 
 #endif // FILEHDR_H
@@ -11,33 +11,56 @@
 //
 // 	The file system consists of several data structures:
 //	   A bitmap of free disk sectors (cf. bitmap.h)
-//	   A directory of file names and file headers
+//	   A tree of directories of file names and file headers
 //
-//      Both the bitmap and the directory are represented as normal
+//      Both the bitmap and the root directory are represented as normal
 //	files.  Their file headers are located in specific sectors
 //	(sector 0 and sector 1), so that the file system can find them 
 //	on bootup.
 //
+//	Files are named by paths from the root, such as "/usr/bin/sh";
+//	the leading "/" may be left out, and "." and ".." work as in UNIX.
+//
 //	The file system assumes that the bitmap and directory files are
 //	kept "open" continuously while Nachos is running.
 //
-//	For those operations (such as Create, Remove) that modify the
-//	directory and/or bitmap, if the operation succeeds, the changes
-//	are written immediately back to disk (the two files are kept
-//	open during all this time).  If the operation fails, and we have
-//	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	The bitmap is kept in memory the whole time, and only written
+//	back to its file at the end of each operation that changes it.
+//	File headers are kept in the inode cache, and the results of
+//	directory lookups in a name cache, so that opening a file whose
+//	path was recently used reads nothing from the disk.  Directory
+//	entries themselves are written as they change, through the
+//	buffer cache.
+//
+//	Every sector that Create, Mkdir or Remove changes -- directory,
+//	bitmap and file headers alike -- goes into the metadata journal
+//	(cf. journal.h), whose file header is in sector 2.  So after a
+//	crash, mounting the disk brings each operation back either
+//	complete or not at all.
+//
+//	Sectors are allocated by locality rather than first fit (cf.
+//	pbitmap.h): a new file's header goes in the first run of free
+//	sectors after its directory's header that has room for the file
+//	too, and its data follows the header.  A new directory goes in
+//	the middle of the largest free area, to leave room around it for
+//	its files.  So the files of a directory end up near each other,
+//	and each in one piece if it can be.
+//
+//	If an operation (such as Create) fails part way through, it
+//	undoes whatever it did to the bitmap.
+//
+//	The operations below are serialized by one lock, so that threads
+//	creating and removing files at the same time cannot lose each
+//	other's directory entries, or sectors.  Reads and writes of an
+//	open file do not take it.
 //
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
 //	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
-//	   there is no attempt to make the system robust to failures
-//	    (if Nachos exits in the middle of an operation that modifies
-//	    the file system, it may corrupt the disk)
+//	     (directories grow as needed)
+//	   there is no current directory; every path starts at the root
+//	   only the metadata is journaled; file data written shortly
+//	    before a crash may be lost
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -52,19 +75,22 @@
 #include "filesys.h"
 #include "debug.h"
 #include "pbitmap.h"
+#include "bufcache.h"
+#include "fscache.h"
+#include "journal.h"
+#include "synch.h"
+#include "main.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
-// and the directory of files.  These file headers are placed in well-known 
-// sectors, so that they can be located on boot-up.
+// the directory of files, and the journal.  These file headers are placed
+// in well-known sectors, so that they can be located on boot-up.
 #define FreeMapSector 		0
 #define DirectorySector 	1
+#define JournalSector 		2
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
+// Initial file size for the bitmap; directories start out
+// DirectoryFileSize long, and grow as files are added to them.
 #define FreeMapFileSize 	(NumSectors / BitsInByte)
-#define NumDirEntries 		10
-#define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
 
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
@@ -73,8 +99,10 @@
 //	an empty directory, and a bitmap of free sectors (with almost but
 //	not all of the sectors marked as free).  
 //
-//	If format = FALSE, we just have to open the files
-//	representing the bitmap and the directory.
+//	If format = FALSE, we have to replay the journal, to finish
+//	whatever was committed before Nachos last stopped; then just open
+//	the files representing the bitmap and the directory, and read in
+//	the bitmap.
 //
 //	"format" -- should we initialize the disk?
 //----------------------------------------------------------------------
@@ -82,24 +110,30 @@
 FileSystem::FileSystem(bool format)
 { 
     DEBUG(dbgFile, "Initializing the file system.");
+    lock = new Lock("file system lock");
+    names = new NameCache;
+    freeMapDirty = FALSE;
     if (format) {
-        PersistBitMap *freeMap = new PersistBitMap(NumSectors);
-        Directory *directory = new Directory(NumDirEntries);
+        Directory *directory;
 	FileHeader *mapHdr = new FileHeader;
 	FileHeader *dirHdr = new FileHeader;
+	FileHeader *journalHdr = new FileHeader;
 
         DEBUG(dbgFile, "Formatting the file system.");
+	freeMap = new PersistBitMap(NumSectors);
 
     // First, allocate space for FileHeaders for the directory and bitmap
     // (make sure no one else grabs these!)
 	freeMap->Mark(FreeMapSector);	    
 	freeMap->Mark(DirectorySector);
+	freeMap->Mark(JournalSector);
 
     // Second, allocate space for the data blocks containing the contents
     // of the directory and bitmap files.  There better be enough space!
 
-	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize));
-	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize));
+	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize, FreeMapSector));
+	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize, DirectorySector));
+	ASSERT(journalHdr->Allocate(freeMap, JournalFileSize, JournalSector));
 
     // Flush the bitmap and directory FileHeaders back to disk
     // We need to do this before we can "Open" the file, since open
@@ -109,6 +143,7 @@ FileSystem::FileSystem(bool format)
         DEBUG(dbgFile, "Writing headers back to disk.");
 	mapHdr->WriteBack(FreeMapSector);    
 	dirHdr->WriteBack(DirectorySector);
+	journalHdr->WriteBack(JournalSector);
 
     // OK to open the bitmap and directory files now
     // The file system operations assume these two files are left open
@@ -119,28 +154,180 @@ FileSystem::FileSystem(bool format)
      
     // Once we have the files "open", we can write the initial version
     // of each file back to disk.  The directory at this point is completely
-    // empty; but the bitmap has been changed to reflect the fact that
-    // sectors on the disk have been allocated for the file headers and
-    // to hold the file data for the directory and bitmap.
+    // empty (and is its own parent); but the bitmap has been changed to
+    // reflect the fact that sectors on the disk have been allocated for
+    // the file headers and to hold the file data for the directory and
+    // bitmap.
 
         DEBUG(dbgFile, "Writing bitmap and directory back to disk.");
 	freeMap->WriteBack(freeMapFile);	 // flush changes to disk
-	directory->WriteBack(directoryFile);
+	directory = new Directory(directoryFile);
+	directory->Format(DirectorySector);
 
 	if (debug->IsEnabled('f')) {
 	    freeMap->Print();
 	    directory->Print();
         }
-        delete freeMap; 
 	delete directory; 
 	delete mapHdr; 
 	delete dirHdr;
+	delete journalHdr;
+
+    // Get all that onto the disk before starting an empty journal, so
+    // that there is nothing for it to replay
+	kernel->bufferCache->Sync();
+	journal = new Journal(kernel->synchDisk, JournalSector);
+	journal->Format();
     } else {
-    // if we are not formatting the disk, just open the files representing
-    // the bitmap and directory; these are left open while Nachos is running
+    // if we are not formatting the disk, bring it up to date from the
+    // journal first; then just open the files representing the bitmap
+    // and directory; these are left open while Nachos is running
+	journal = new Journal(kernel->synchDisk, JournalSector);
+	journal->Replay();
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
+	freeMap = new PersistBitMap(freeMapFile, NumSectors);
+    }
+    kernel->bufferCache->UseJournal(journal);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::~FileSystem
+// 	Close the bitmap and directory files.  Anything not synced or
+//	committed to the journal is lost.
+//----------------------------------------------------------------------
+
+FileSystem::~FileSystem()
+{
+    kernel->bufferCache->UseJournal(NULL);
+    delete journal;
+    delete freeMap;
+    delete names;
+    delete freeMapFile;
+    delete directoryFile;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// NextComponent
+// 	Copy the next component of the path "*path" into "name", and
+//	step past it and the "/"s around it.  Return FALSE if it is too
+//	long to be a file name.
+//----------------------------------------------------------------------
+
+static bool
+NextComponent(char **path, char *name)
+{
+    int length = 0;
+
+    while (**path == '/')
+	(*path)++;
+    while (**path != '\0' && **path != '/') {
+	if (length == FileNameMaxLen)
+	    return FALSE;
+	name[length++] = *(*path)++;
+    }
+    name[length] = '\0';
+    while (**path == '/')
+	(*path)++;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// IsSpecial
+// 	Is "name" one that can't be created or removed: the empty name
+//	(the path named a directory, such as "/"), "." or ".."?
+//----------------------------------------------------------------------
+
+static bool
+IsSpecial(char *name)
+{
+    return name[0] == '\0' || !strcmp(name, ".") || !strcmp(name, "..");
+}
+
+//----------------------------------------------------------------------
+// FileSystem::OpenDirectory/CloseDirectory
+// 	Open/close the directory whose file header is at "sector".  The
+//	root directory is always open, so it is not opened again.
+//----------------------------------------------------------------------
+
+OpenFile *
+FileSystem::OpenDirectory(int sector)
+{
+    if (sector == DirectorySector)
+	return directoryFile;
+    return new OpenFile(sector);
+}
+
+void
+FileSystem::CloseDirectory(OpenFile *dirFile)
+{
+    if (dirFile != directoryFile)
+	delete dirFile;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Lookup
+// 	Look "name" up in the directory whose file header is at
+//	"dirSector", and return the sector of its file header, or -1 if
+//	it isn't there.  "", "." and ".." name the directory itself and
+//	its parent.
+//
+//	The name cache is checked first, and told what is found.
+//
+//	"isDir" -- set to whether the file found is a directory
+//----------------------------------------------------------------------
+
+int
+FileSystem::Lookup(int dirSector, char *name, bool *isDir)
+{
+    OpenFile *dirFile;
+    Directory *directory;
+    int sector;
+
+    *isDir = TRUE;
+    if (name[0] == '\0' || !strcmp(name, "."))
+	return dirSector;
+    sector = names->Find(dirSector, name, isDir);
+    if (sector != -1)
+	return sector;
+    dirFile = OpenDirectory(dirSector);
+    directory = new Directory(dirFile);
+    if (!strcmp(name, ".."))
+	sector = directory->Parent();
+    else
+	sector = directory->Find(name, isDir);
+    delete directory;
+    CloseDirectory(dirFile);
+    if (sector != -1)
+	names->Enter(dirSector, name, sector, *isDir);
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FindDirectory
+// 	Follow "path" from the root, up to its last component.  Return
+//	the sector of the file header of the directory that component
+//	is in, and copy the component into "name"; return -1 if some
+//	directory along the way does not exist, or a name is too long.
+//
+//	"name" -- room for FileNameMaxLen + 1 characters
+//----------------------------------------------------------------------
+
+int
+FileSystem::FindDirectory(char *path, char *name)
+{
+    int sector = DirectorySector;
+    bool isDir;
+
+    if (!NextComponent(&path, name))
+	return -1;
+    while (*path != '\0') {		// "name" must be a directory
+	sector = Lookup(sector, name, &isDir);
+	if (sector == -1 || !isDir || !NextComponent(&path, name))
+	    return -1;
     }
+    return sector;
 }
 
 //----------------------------------------------------------------------
@@ -150,68 +337,128 @@ FileSystem::FileSystem(bool format)
 //	to give Create the initial size of the file.
 //
 //	The steps to create a file are:
+//	  Find the directory it goes in
 //	  Make sure the file doesn't already exist
 //        Allocate a sector for the file header
 // 	  Allocate space on disk for the data blocks for the file
+//	  Put the new file header in the inode cache
 //	  Add the name to the directory
-//	  Store the new file header on disk 
-//	  Flush the changes to the bitmap and the directory back to disk
 //
 //	Return TRUE if everything goes ok, otherwise, return FALSE.
 //
 // 	Create fails if:
+//		a directory on the path doesn't exist
 //   		file is already in directory
 //	 	no free space for file header
-//	 	no free entry for file in directory
 //	 	no free space for data blocks for the file 
+//	 	no free space for the directory to grow
 //
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
-//
-//	"name" -- name of file to be created
+//	"name" -- path name of file to be created
 //	"initialSize" -- size of file to be created
 //----------------------------------------------------------------------
 
 bool
 FileSystem::Create(char *name, int initialSize)
 {
-    Directory *directory;
-    PersistBitMap *freeMap;
-    FileHeader *hdr;
-    int sector;
     bool success;
 
     DEBUG(dbgFile, "Creating file " << name << " size " << initialSize);
+    lock->Acquire();
+    success = AddFile(name, initialSize, FALSE);
+    lock->Release();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Mkdir
+// 	Create an empty directory (similar to UNIX mkdir).  Return TRUE
+//	if everything goes ok; fails for the same reasons as Create.
+//
+//	"name" -- path name of the directory to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Mkdir(char *name)
+{
+    bool success;
+
+    DEBUG(dbgFile, "Creating directory " << name);
+    lock->Acquire();
+    success = AddFile(name, DirectoryFileSize, TRUE);
+    lock->Release();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::AddFile
+// 	Do the work of Create and Mkdir, with the lock held.  A new
+//	directory is formatted
+//	before its name goes in its parent.  Once the name is known to
+//	be new, everything is done as one journaled operation.
+//----------------------------------------------------------------------
+
+bool
+FileSystem::AddFile(char *path, int initialSize, bool isDir)
+{
+    char name[FileNameMaxLen + 1];
+    OpenFile *dirFile;
+    Directory *directory;
+    Inode *inode;
+    int dirSector, sector;
+    bool existingIsDir, success;
+
+    dirSector = FindDirectory(path, name);
+    if (dirSector == -1 || IsSpecial(name))
+	return FALSE;			// no such directory, or no name
+    if (Lookup(dirSector, name, &existingIsDir) != -1)
+	return FALSE;			// file is already in directory
+    journal->Begin();
+    // find a sector to hold the file header: for a file, near the
+    // directory's, with room for the data right after it; for a new
+    // directory, away from the others
+    if (isDir)
+	sector = freeMap->FindAndSetApart();
+    else
+	sector = freeMap->FindAndSetNear(dirSector,
+				1 + divRoundUp(initialSize, SectorSize));
+    if (sector == -1) {
+	journal->End();
+	return FALSE;			// no free block for file header
+    }
+    inode = kernel->inodeCache->New(sector);
+    if (!inode->hdr->Allocate(freeMap, initialSize, sector + 1)) {
+	kernel->inodeCache->Forget(inode);
+	kernel->inodeCache->Release(inode);
+	freeMap->Clear(sector);
+	journal->End();
+	return FALSE;			// no space on disk for data
+    }
+    if (isDir) {
+	OpenFile *newFile = new OpenFile(sector);
+	Directory *newDir = new Directory(newFile);
 
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-
-    if (directory->Find(name) != -1)
-      success = FALSE;			// file is already in directory
-    else {	
-        freeMap = new PersistBitMap(NumSectors);
-        freeMap->FetchFrom(freeMapFile);
-        sector = freeMap->FindAndSet();	// find a sector to hold the file header
-    	if (sector == -1) 		
-            success = FALSE;		// no free block for file header 
-        else if (!directory->Add(name, sector))
-            success = FALSE;	// no space in directory
-	else {
-    	    hdr = new FileHeader;
-	    if (!hdr->Allocate(freeMap, initialSize))
-            	success = FALSE;	// no space on disk for data
-	    else {	
-	    	success = TRUE;
-		// everthing worked, flush all changes back to disk
-    	    	hdr->WriteBack(sector); 		
-    	    	directory->WriteBack(directoryFile);
-    	    	freeMap->WriteBack(freeMapFile);
-	    }
-            delete hdr;
-	}
-        delete freeMap;
+	newDir->Format(dirSector);
+	delete newDir;
+	delete newFile;
     }
+
+    dirFile = OpenDirectory(dirSector);
+    directory = new Directory(dirFile);
+    success = directory->Add(name, sector, isDir, freeMap);
     delete directory;
+    CloseDirectory(dirFile);
+    if (success)
+	names->Enter(dirSector, name, sector, isDir);
+    else {				// no space for directory to grow
+	inode->hdr->Deallocate(freeMap);
+	kernel->inodeCache->Forget(inode);
+	freeMap->Clear(sector);
+    }
+    kernel->inodeCache->Release(inode);
+    freeMapDirty = TRUE;		// even on failure, the directory
+					// may have grown
+    WriteBack();
+    journal->End();
     return success;
 }
 
@@ -219,88 +466,125 @@ FileSystem::Create(char *name, int initialSize)
 // FileSystem::Open
 // 	Open a file for reading and writing.  
 //	To open a file:
-//	  Find the location of the file's header, using the directory 
+//	  Find the location of the file's header, using the directories
+//	  on its path
 //	  Bring the header into memory
 //
-//	"name" -- the text name of the file to be opened
+//	"name" -- the path name of the file to be opened
 //----------------------------------------------------------------------
 
 OpenFile *
 FileSystem::Open(char *name)
 { 
-    Directory *directory = new Directory(NumDirEntries);
+    char last[FileNameMaxLen + 1];
     OpenFile *openFile = NULL;
     int sector;
+    bool isDir;
 
     DEBUG(dbgFile, "Opening file" << name);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name); 
+    lock->Acquire();
+    sector = FindDirectory(name, last);
+    if (sector >= 0)
+	sector = Lookup(sector, last, &isDir);
     if (sector >= 0) 		
 	openFile = new OpenFile(sector);	// name was found in directory 
-    delete directory;
+    lock->Release();
     return openFile;				// return NULL if not found
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Remove
 // 	Delete a file from the file system.  This requires:
-//	    Remove it from the directory
+//	    Remove it from its directory
 //	    Delete the space for its header
 //	    Delete the space for its data blocks
-//	    Write changes to directory, bitmap back to disk
+//	    Write changes to bitmap back to disk
+//	all as one journaled operation.
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system, or is a directory with files still in it.
 //
-//	"name" -- the text name of the file to be removed
+//	"name" -- the path name of the file to be removed
 //----------------------------------------------------------------------
 
 bool
 FileSystem::Remove(char *name)
 { 
+    bool success;
+
+    lock->Acquire();
+    success = RemoveFile(name);
+    lock->Release();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::RemoveFile
+// 	Do the work of Remove, with the lock held.
+//----------------------------------------------------------------------
+
+bool
+FileSystem::RemoveFile(char *name)
+{
+    char last[FileNameMaxLen + 1];
+    OpenFile *dirFile;
     Directory *directory;
-    PersistBitMap *freeMap;
-    FileHeader *fileHdr;
-    int sector;
+    Inode *inode;
+    int dirSector, sector;
+    bool isDir;
     
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
-    if (sector == -1) {
-       delete directory;
-       return FALSE;			 // file not found 
+    dirSector = FindDirectory(name, last);
+    if (dirSector == -1 || IsSpecial(last))
+	return FALSE;
+    sector = Lookup(dirSector, last, &isDir);
+    if (sector == -1)
+	return FALSE;			 // file not found 
+    if (isDir) {
+	OpenFile *subFile = new OpenFile(sector);
+	Directory *sub = new Directory(subFile);
+	bool empty = sub->IsEmpty();
+
+	delete sub;
+	delete subFile;
+	if (!empty)
+	    return FALSE;		// only empty directories go
+	names->Forget(sector, "..");
     }
-    fileHdr = new FileHeader;
-    fileHdr->FetchFrom(sector);
-
-    freeMap = new PersistBitMap(NumSectors);
-    freeMap->FetchFrom(freeMapFile);
 
-    fileHdr->Deallocate(freeMap);  		// remove data blocks
+    journal->Begin();
+    inode = kernel->inodeCache->Get(sector);
+    inode->hdr->Deallocate(freeMap);  		// remove data blocks
     freeMap->Clear(sector);			// remove header block
-    directory->Remove(name);
-
-    freeMap->WriteBack(freeMapFile);		// flush to disk
-    directory->WriteBack(directoryFile);        // flush to disk
-    delete fileHdr;
+    freeMapDirty = TRUE;
+    kernel->inodeCache->Forget(inode);
+    kernel->inodeCache->Release(inode);
+
+    dirFile = OpenDirectory(dirSector);
+    directory = new Directory(dirFile);
+    directory->Remove(last);
+    names->Forget(dirSector, last);
     delete directory;
-    delete freeMap;
+    CloseDirectory(dirFile);
+    WriteBack();
+    journal->End();
     return TRUE;
 } 
 
 //----------------------------------------------------------------------
 // FileSystem::List
-// 	List all the files in the file system directory.
+// 	List all the files in the file system, directory by directory.
 //----------------------------------------------------------------------
 
 void
 FileSystem::List()
 {
-    Directory *directory = new Directory(NumDirEntries);
+    Directory *directory;
 
-    directory->FetchFrom(directoryFile);
+    lock->Acquire();
+    directory = new Directory(directoryFile);
     directory->List();
     delete directory;
+    lock->Release();
 }
 
 //----------------------------------------------------------------------
@@ -311,6 +595,9 @@ FileSystem::List()
 //	  for each file in the directory,
 //	      the contents of the file header
 //	      the data in the file
+//
+//	The cached metadata is written back first, so that what is
+//	printed from the sectors is up to date.
 //----------------------------------------------------------------------
 
 void
@@ -318,9 +605,11 @@ FileSystem::Print()
 {
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
-    PersistBitMap *freeMap = new PersistBitMap(NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
+    Directory *directory;
 
+    lock->Acquire();
+    directory = new Directory(directoryFile);
+    WriteBack();
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
     bitHdr->Print();
@@ -329,14 +618,64 @@ FileSystem::Print()
     dirHdr->FetchFrom(DirectorySector);
     dirHdr->Print();
 
-    freeMap->FetchFrom(freeMapFile);
     freeMap->Print();
+    freeMap->PrintFragmentation();
 
-    directory->FetchFrom(directoryFile);
     directory->Print();
 
     delete bitHdr;
     delete dirHdr;
-    delete freeMap;
     delete directory;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::WriteBack
+// 	Write the bitmap, if it has changed, and every changed file
+//	header back to their sectors (in the buffer cache).  Called at
+//	the end of each operation, so that they go in the journal with
+//	the rest of it.
+//----------------------------------------------------------------------
+
+void
+FileSystem::WriteBack()
+{
+    if (freeMapDirty) {
+	freeMap->WriteBack(freeMapFile);
+	freeMapDirty = FALSE;
+    }
+    kernel->inodeCache->Sync();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Sync
+// 	Write all the cached metadata, and everything the buffer cache
+//	is holding, back to disk.  Returns once it is all there, and
+//	the journal is empty.
+//----------------------------------------------------------------------
+
+void
+FileSystem::Sync()
+{
+    lock->Acquire();
+    WriteBack();
+    lock->Release();
+    journal->Checkpoint();
+    kernel->bufferCache->Sync();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FreeSectors
+// 	Return how many sectors of the disk are free.
+//----------------------------------------------------------------------
+
+int
+FileSystem::FreeSectors()
+{
+    int free;
+
+    lock->Acquire();
+    free = freeMap->NumClear();
+    lock->Release();
+    return free;
 }
@@ -65,6 +65,11 @@ class FileSystem {
 };
 
 #else // FILESYS
+class PersistBitMap;
+class NameCache;
+class Journal;
+class Lock;
+
 class FileSystem {
   public:
     FileSystem(bool format=true);		// Initialize the file system.
@@ -72,24 +77,51 @@ class FileSystem {
 					// has been initialized.
     					// If "format", there is nothing on
 					// the disk, so initialize the directory
-    					// and the bitmap of free blocks.
+    					// and the bitmap of free blocks;
+					// otherwise replay the journal.
+    ~FileSystem();
 
     bool Create(char *name, int initialSize);  	
 					// Create a file (UNIX creat)
 
+    bool Mkdir(char *name);		// Create a directory (UNIX mkdir)
+
     OpenFile* Open(char *name); 	// Open a file (UNIX open)
 
-    bool Remove(char *name);  		// Delete a file (UNIX unlink)
+    bool Remove(char *name);  		// Delete a file, or an empty
+					// directory (UNIX unlink, rmdir)
 
     void List();			// List all the files in the file system
 
     void Print();			// List all the files and their contents
 
+    void Sync();			// Write all cached changes to disk
+
+    int FreeSectors();			// How many sectors are not in use
+
   private:
+   Lock *lock;				// Lets one operation at a time at
+					// the directories, bitmap and
+					// file headers
    OpenFile* freeMapFile;		// Bit map of free disk blocks,
 					// represented as a file
    OpenFile* directoryFile;		// "Root" directory -- list of 
 					// file names, represented as a file
+   PersistBitMap *freeMap;		// The bitmap, kept in memory
+   bool freeMapDirty;			// ... and changed since written back
+   NameCache *names;			// Recent directory lookups
+   Journal *journal;			// Log of metadata changes
+
+   bool AddFile(char *path, int initialSize, bool isDir);
+					// Create a file or directory
+   bool RemoveFile(char *path);		// Delete a file or directory
+   int FindDirectory(char *path, char *name);
+					// Find the directory "path" ends in
+   int Lookup(int dirSector, char *name, bool *isDir);
+					// Find "name" in one directory
+   OpenFile *OpenDirectory(int sector);
+   void CloseDirectory(OpenFile *dirFile);
+   void WriteBack();			// Put cached metadata in its sectors
 };
 
 #endif // FILESYS
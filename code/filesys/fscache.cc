@@ -0,0 +1,290 @@
+// fscache.cc
+//	Routines for the file header and directory lookup caches.  See
+//	fscache.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "filehdr.h"
+#include "fscache.h"
+#include <string.h>
+
+//----------------------------------------------------------------------
+// InodeKey, HashSector
+// 	What the hash table needs to know about inodes and sectors.
+//----------------------------------------------------------------------
+
+static int
+InodeKey(Inode *inode)
+{
+    return inode->sector;
+}
+
+static unsigned
+HashSector(int sector)
+{
+    return (unsigned) sector;
+}
+
+//----------------------------------------------------------------------
+// Inode::Inode, Inode::~Inode
+//----------------------------------------------------------------------
+
+Inode::Inode(int hdrSector)
+{
+    sector = hdrSector;
+    hdr = new FileHeader;
+    refCount = 0;
+    dirty = FALSE;
+    removed = FALSE;
+}
+
+Inode::~Inode()
+{
+    delete hdr;
+}
+
+//----------------------------------------------------------------------
+// InodeCache::InodeCache
+// 	Start with nothing cached.
+//----------------------------------------------------------------------
+
+InodeCache::InodeCache()
+{
+    table = new HashTable<int, Inode *>(InodeKey, HashSector);
+    unused = new List<Inode *>;
+}
+
+//----------------------------------------------------------------------
+// InodeCache::~InodeCache
+// 	Throw everything away.  Call Sync first to keep the changes.
+//----------------------------------------------------------------------
+
+InodeCache::~InodeCache()
+{
+    List<Inode *> all;
+    HashIterator<int, Inode *> iter(table);
+
+    for (; !iter.IsDone(); iter.Next())
+	all.Append(iter.Item());
+    while (!all.IsEmpty()) {
+	Inode *inode = all.RemoveFront();
+
+	table->Remove(inode->sector);
+	delete inode;
+    }
+    while (!unused->IsEmpty())
+	(void) unused->RemoveFront();
+    delete unused;
+    delete table;
+}
+
+//----------------------------------------------------------------------
+// InodeCache::Get
+// 	Return the cached header at "sector", fetching it from disk if
+//	it isn't cached, and count one more reference to it.
+//----------------------------------------------------------------------
+
+Inode *
+InodeCache::Get(int sector)
+{
+    Inode *inode;
+
+    if (table->Find(sector, &inode)) {
+	DEBUG(dbgFile, "Inode cache hit on " << sector);
+	if (inode->refCount == 0)
+	    unused->Remove(inode);
+    } else {
+	inode = new Inode(sector);
+	inode->hdr->FetchFrom(sector);
+	table->Insert(inode);
+    }
+    inode->refCount++;
+    return inode;
+}
+
+//----------------------------------------------------------------------
+// InodeCache::New
+// 	Return an empty header for a file being created at "sector".
+//	Nothing is read from disk; it is dirty from the start.
+//----------------------------------------------------------------------
+
+Inode *
+InodeCache::New(int sector)
+{
+    Inode *inode = new Inode(sector);
+
+    ASSERT(!table->IsInTable(sector));
+    inode->dirty = TRUE;
+    inode->refCount = 1;
+    table->Insert(inode);
+    return inode;
+}
+
+//----------------------------------------------------------------------
+// InodeCache::Release
+// 	Drop a reference to "inode".  If that was the last one, keep it
+//	around in case the file is opened again, writing back and
+//	throwing out the header released longest ago to make room.
+//----------------------------------------------------------------------
+
+void
+InodeCache::Release(Inode *inode)
+{
+    ASSERT(inode->refCount > 0);
+    if (--inode->refCount > 0)
+	return;
+    if (inode->removed) {
+	delete inode;
+	return;
+    }
+    unused->Append(inode);
+    if (unused->NumInList() > NumCachedInodes) {
+	Inode *victim = unused->RemoveFront();
+
+	if (victim->dirty)
+	    victim->hdr->WriteBack(victim->sector);
+	table->Remove(victim->sector);
+	delete victim;
+    }
+}
+
+//----------------------------------------------------------------------
+// InodeCache::Forget
+// 	The file whose header is "inode" has been removed, and its
+//	sectors freed.  Take it out of the cache, so that a new file
+//	given the same header sector starts afresh; it goes away for
+//	good when the caller releases it.
+//----------------------------------------------------------------------
+
+void
+InodeCache::Forget(Inode *inode)
+{
+    ASSERT(inode->refCount > 0 && !inode->removed);
+    table->Remove(inode->sector);
+    inode->removed = TRUE;
+    inode->dirty = FALSE;
+}
+
+//----------------------------------------------------------------------
+// InodeCache::Sync
+// 	Write every changed header back.  (This only puts them in the
+//	buffer cache; syncing that gets them to disk.)
+//----------------------------------------------------------------------
+
+static void
+WriteBackInode(Inode *inode)
+{
+    if (inode->dirty) {
+	inode->hdr->WriteBack(inode->sector);
+	inode->dirty = FALSE;
+    }
+}
+
+void
+InodeCache::Sync()
+{
+    table->Apply(WriteBackInode);
+}
+
+//----------------------------------------------------------------------
+// NameCache::NameCache
+// 	Start with nothing remembered.
+//----------------------------------------------------------------------
+
+NameCache::NameCache()
+{
+    for (int i = 0; i < NumCachedNames; i++)
+	entries[i].sector = -1;
+    for (int i = 0; i < NumNameBuckets; i++)
+	buckets[i] = NULL;
+    hand = 0;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Link
+// 	Return the link on the hash chain for "dir" and "name" that
+//	points to the entry for them, or that is NULL if there isn't one.
+//----------------------------------------------------------------------
+
+CachedName **
+NameCache::Link(int dir, char *name)
+{
+    unsigned int hash = (unsigned) dir;
+    CachedName **link;
+
+    for (int i = 0; i < FileNameMaxLen && name[i] != '\0'; i++)
+	hash = hash * 31 + (unsigned char) name[i];
+    link = &buckets[hash % NumNameBuckets];
+    while (*link != NULL && ((*link)->dir != dir ||
+		strncmp((*link)->name, name, FileNameMaxLen) != 0))
+	link = &(*link)->hashNext;
+    return link;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Find
+// 	Return the header sector of the file "name" in the directory
+//	whose header is at "dir", or -1 if it isn't remembered.
+//
+//	"isDir" -- set to whether the file is a directory
+//----------------------------------------------------------------------
+
+int
+NameCache::Find(int dir, char *name, bool *isDir)
+{
+    CachedName *entry = *Link(dir, name);
+
+    if (entry == NULL)
+	return -1;
+    *isDir = entry->isDir;
+    return entry->sector;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Enter
+// 	Remember that "name" in "dir" is at "sector", replacing the
+//	entry remembered longest ago if need be.
+//----------------------------------------------------------------------
+
+void
+NameCache::Enter(int dir, char *name, int sector, bool isDir)
+{
+    CachedName **link = Link(dir, name);
+    CachedName *entry = *link;
+
+    if (entry == NULL) {
+	entry = &entries[hand];
+	hand = (hand + 1) % NumCachedNames;
+	if (entry->sector != -1)
+	    Forget(entry->dir, entry->name);
+	link = Link(dir, name);		// Forget may have changed it
+	entry->dir = dir;
+	strncpy(entry->name, name, FileNameMaxLen);
+	entry->name[FileNameMaxLen] = '\0';
+	entry->hashNext = NULL;
+	*link = entry;
+    }
+    entry->sector = sector;
+    entry->isDir = isDir;
+}
+
+//----------------------------------------------------------------------
+// NameCache::Forget
+// 	"name" has been removed from "dir"; forget about it.
+//----------------------------------------------------------------------
+
+void
+NameCache::Forget(int dir, char *name)
+{
+    CachedName **link = Link(dir, name);
+    CachedName *entry = *link;
+
+    if (entry != NULL) {
+	*link = entry->hashNext;
+	entry->sector = -1;
+    }
+}
@@ -0,0 +1,111 @@
+// fscache.h
+//	Data structures for caching file system metadata in memory:
+//	file headers (an "inode cache") and the results of directory
+//	lookups (a "name cache", or in UNIX terms a dentry cache).
+//
+//	The buffer cache already keeps recently used sectors in memory,
+//	but a file header still has to be decoded from its sectors every
+//	time a file is opened, and a directory lookup reads two of them.
+//	With these caches in front, opening a file whose path and header
+//	were used recently touches no sectors at all.
+//
+//	Changes to a cached file header are only written back to its
+//	sectors when the header is thrown out of the cache, or on Sync.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FSCACHE_H
+#define FSCACHE_H
+
+#include "copyright.h"
+#include "directory.h"
+#include "hash.h"
+#include "list.h"
+
+class FileHeader;
+
+const int NumCachedInodes = 64;		// headers kept that no open file
+					// is using
+const int NumCachedNames = 256;		// directory entries remembered
+const int NumNameBuckets = 64;
+
+// The in-memory copy of one file header, shared by every OpenFile
+// on the file.
+
+class Inode {
+  public:
+    Inode(int hdrSector);
+    ~Inode();
+
+    int sector;			// where the header lives on disk
+    FileHeader *hdr;
+    int refCount;		// OpenFiles (and others) using it
+    bool dirty;			// hdr is newer than the disk
+    bool removed;		// the file is gone; don't write it back
+};
+
+// All the cached file headers, by sector.  A header nobody is using
+// stays in the cache until NumCachedInodes others have been released
+// after it.
+//
+// Callers are expected to provide mutual exclusion, as for the rest
+// of the file system.
+
+class InodeCache {
+  public:
+    InodeCache();
+    ~InodeCache();
+
+    Inode *Get(int sector);		// the header at "sector", read in
+					// if need be; Release it when done
+    Inode *New(int sector);		// the header for a new file, to be
+					// filled in by Allocate
+    void Release(Inode *inode);		// done with "inode"
+    void Forget(Inode *inode);		// the file was removed
+    void Sync();			// write back every dirty header
+
+  private:
+    HashTable<int, Inode *> *table;	// every cached header, by sector
+    List<Inode *> *unused;		// the ones with no references,
+					// least recently released first
+};
+
+// One remembered directory lookup: "name" in the directory whose
+// header is at "dir" is the file whose header is at "sector".
+
+class CachedName {
+  public:
+    int dir;
+    char name[FileNameMaxLen + 1];
+    int sector;			// -1 if the entry is free
+    bool isDir;
+    CachedName *hashNext;	// next on its hash chain
+};
+
+// A fixed number of remembered lookups, replaced in turn.  Only names
+// that exist are remembered; the file system tells the cache when one
+// is removed.
+
+class NameCache {
+  public:
+    NameCache();
+
+    int Find(int dir, char *name, bool *isDir);
+					// the remembered sector, or -1
+    void Enter(int dir, char *name, int sector, bool isDir);
+    void Forget(int dir, char *name);
+
+  private:
+    CachedName entries[NumCachedNames];
+    CachedName *buckets[NumNameBuckets];
+    int hand;				// entry to replace next
+
+    CachedName **Link(int dir, char *name);
+					// the pointer to the entry for
+					// "name" on its chain, or to the
+					// NULL at the end of the chain
+};
+
+#endif // FSCACHE_H
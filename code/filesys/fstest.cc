@@ -7,6 +7,11 @@
 //	   Perftest -- a stress test for the Nachos file system
 //		read and write a really large file in tiny chunks
 //		(won't work on baseline system!)
+//	   JournalCrashTest, JournalReplayTest -- check that what several
+//		threads create and remove at once, and the journal commits
+//		on its own, survives a crash
+//	   FileSysSelfTest -- check the file system's parts on a freshly
+//		formatted disk
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -20,6 +25,9 @@
 #include "thread.h"
 #include "disk.h"
 #include "stats.h"
+#include "journal.h"
+#include "synch.h"
+#include "sysdep.h"
 
 #define TransferSize 	10 	// make it small, just to be difficult
 
@@ -183,3 +191,675 @@ PerformanceTest()
     kernel->stats->Print();
 }
 
+
+//----------------------------------------------------------------------
+// FileSysSelfTest
+// 	Test the file system on a freshly formatted disk, one part at
+//	a time (see selfTests below).  Each test prints what it found,
+//	and returns FALSE if that was wrong.
+//----------------------------------------------------------------------
+
+static char
+Pattern(int file, int pos)
+{
+    return (char) (file * 7 + pos * 31 + pos / SectorSize);
+}
+
+//----------------------------------------------------------------------
+// CheckFile
+// 	Return TRUE if the Nachos file "name" holds exactly "size" bytes
+//	of Pattern(file, ...).
+//----------------------------------------------------------------------
+
+static bool
+CheckFile(char *name, int file, int size)
+{
+    OpenFile *openFile = kernel->fileSystem->Open(name);
+    char data[SectorSize];
+    bool ok = (openFile != NULL && openFile->Length() == size);
+    int pos, n;
+
+    for (pos = 0; ok && pos < size; pos += n) {
+	n = openFile->Read(data, SectorSize);
+	ok = (n > 0);
+	for (int i = 0; ok && i < n; i++)
+	    ok = (data[i] == Pattern(file, pos + i));
+    }
+    delete openFile;
+    return ok;
+}
+
+//----------------------------------------------------------------------
+// MakeFile
+// 	Create the Nachos file "name", and fill it with "size" bytes of
+//	Pattern(file, ...).  Return FALSE if that fails.
+//----------------------------------------------------------------------
+
+static bool
+MakeFile(char *name, int file, int size)
+{
+    OpenFile *openFile;
+    char data[SectorSize];
+    int pos, n;
+    bool ok = TRUE;
+
+    if (!kernel->fileSystem->Create(name, size)
+	    || (openFile = kernel->fileSystem->Open(name)) == NULL)
+	return FALSE;
+    for (pos = 0; ok && pos < size; pos += n) {
+	n = min(SectorSize, size - pos);
+	for (int i = 0; i < n; i++)
+	    data[i] = Pattern(file, pos + i);
+	ok = (openFile->Write(data, n) == n);
+    }
+    delete openFile;
+    return ok;
+}
+
+//----------------------------------------------------------------------
+// BufferCacheTest
+// 	Write a file smaller than the buffer cache and read it back,
+//	before and after a Sync.  Every read must be served from the
+//	cache, without a single disk read.
+//----------------------------------------------------------------------
+
+#define CachedFileSize	(8 * SectorSize)
+
+static bool
+BufferCacheTest()
+{
+    int reads, i;
+    bool ok = MakeFile("/cached", 0, CachedFileSize);
+
+    reads = kernel->stats->numDiskReads;
+    for (i = 0; ok && i < 2; i++) {
+	ok = CheckFile("/cached", 0, CachedFileSize);
+	if (i == 0)
+	    kernel->fileSystem->Sync();
+    }
+    reads = kernel->stats->numDiskReads - reads;
+    ok = kernel->fileSystem->Remove("/cached") && ok;
+    printf("Buffer cache test: file %s, %d disk reads\n",
+	ok ? "read back" : "NOT read back", reads);
+    return ok && reads == 0;
+}
+
+//----------------------------------------------------------------------
+// DiskQueueTest
+// 	Have several threads read sectors all over the disk at once,
+//	straight from the SynchDisk.  Each must get what a read done on
+//	its own got, and some requests must have had to queue.
+//----------------------------------------------------------------------
+
+#define QueueWorkers	8
+#define QueueReads	20
+
+static char *queueExpect;		// what each read should return
+static int queueBad;			// reads that returned something else
+static Semaphore *queueDone;		// V'd by each worker when done
+
+static int
+QueueSector(int worker, int i)
+{
+    return (worker * 7919 + i * 104729) % NumSectors;
+}
+
+static void
+QueueWorker(int worker)
+{
+    char data[SectorSize];
+
+    for (int i = 0; i < QueueReads; i++) {
+	kernel->synchDisk->ReadSector(QueueSector(worker, i), data);
+	if (memcmp(data, queueExpect
+		+ (worker * QueueReads + i) * SectorSize, SectorSize) != 0)
+	    queueBad++;
+    }
+    queueDone->V();
+}
+
+static bool
+DiskQueueTest()
+{
+    long long waited;
+    int i;
+
+    kernel->fileSystem->Sync();		// nothing may change the disk
+    queueExpect = new char[QueueWorkers * QueueReads * SectorSize];
+    for (i = 0; i < QueueWorkers * QueueReads; i++)
+	kernel->synchDisk->ReadSector(QueueSector(i / QueueReads,
+			i % QueueReads), queueExpect + i * SectorSize);
+    queueBad = 0;
+    queueDone = new Semaphore("disk queue test", 0);
+    waited = kernel->stats->diskQueueTicks;
+    for (i = 0; i < QueueWorkers; i++) {
+	Thread *t = new Thread("disk queue test");
+	t->Fork((VoidFunctionPtr) QueueWorker, (void *) (long) i);
+    }
+    for (i = 0; i < QueueWorkers; i++)
+	queueDone->P();
+    waited = kernel->stats->diskQueueTicks - waited;
+    delete queueDone;
+    delete [] queueExpect;
+    printf("Disk queue test: %d reads by %d threads, %d bad, "
+	"%lld ticks queued\n", QueueWorkers * QueueReads, QueueWorkers,
+	queueBad, waited);
+    return queueBad == 0 && waited > 0;
+}
+
+//----------------------------------------------------------------------
+// MultiSectorTest
+// 	Write the last track of the disk in one request, read it back
+//	in one, and scattered in two runs listed out of order, then put
+//	back what was there.  Each transfer must take as many disk
+//	requests as it has runs of sectors.
+//----------------------------------------------------------------------
+
+static bool
+MultiSectorTest()
+{
+    int first = NumSectors - SectorsPerTrack;
+    int sectors[SectorsPerTrack];
+    char *buffers[SectorsPerTrack];
+    char *saved = new char[SectorsPerTrack * SectorSize];
+    char *data = new char[SectorsPerTrack * SectorSize];
+    char *got = new char[SectorsPerTrack * SectorSize];
+    int i, requests, bad = 0;
+
+    kernel->fileSystem->Sync();		// nothing may change the disk
+    for (i = 0; i < SectorsPerTrack; i++)
+	kernel->synchDisk->ReadSector(first + i, saved + i * SectorSize);
+    for (i = 0; i < SectorsPerTrack * SectorSize; i++)
+	data[i] = Pattern(1, i);
+
+    requests = kernel->stats->numDiskReads + kernel->stats->numDiskWrites;
+    kernel->synchDisk->WriteSectors(first, SectorsPerTrack, data);
+    kernel->synchDisk->ReadSectors(first, SectorsPerTrack, got);
+    bad += (memcmp(got, data, SectorsPerTrack * SectorSize) != 0);
+
+    for (i = 0; i < SectorsPerTrack; i++) {	// second half first
+	sectors[i] = first + (i + SectorsPerTrack / 2) % SectorsPerTrack;
+	buffers[i] = got + (sectors[i] - first) * SectorSize;
+    }
+    bzero(got, SectorsPerTrack * SectorSize);
+    kernel->synchDisk->ReadScatter(sectors, buffers, SectorsPerTrack);
+    bad += (memcmp(got, data, SectorsPerTrack * SectorSize) != 0);
+    requests = kernel->stats->numDiskReads + kernel->stats->numDiskWrites
+		- requests;
+
+    kernel->synchDisk->WriteSectors(first, SectorsPerTrack, saved);
+    delete [] saved;
+    delete [] data;
+    delete [] got;
+    printf("Multi-sector test: %d bad transfers, %d disk requests\n",
+	bad, requests);
+    return bad == 0 && requests == 4;
+}
+
+//----------------------------------------------------------------------
+// LargeFileTest
+// 	Write a 1MB file, in pieces that don't line up with sectors, and
+//	read it back.
+//----------------------------------------------------------------------
+
+#define LargeFileSize	(1024 * 1024)
+#define LargeChunk	10000		// not a multiple of SectorSize
+
+static bool
+LargeFileTest()
+{
+    OpenFile *openFile;
+    char *data;
+    int pos, n;
+    bool ok = TRUE;
+
+    if (!kernel->fileSystem->Create("/large", LargeFileSize)
+	    || (openFile = kernel->fileSystem->Open("/large")) == NULL) {
+	printf("Large file test: can't create /large\n");
+	return FALSE;
+    }
+    data = new char[LargeChunk];
+    for (pos = 0; ok && pos < LargeFileSize; pos += n) {
+	n = min(LargeChunk, LargeFileSize - pos);
+	for (int i = 0; i < n; i++)
+	    data[i] = Pattern(0, pos + i);
+	ok = (openFile->Write(data, n) == n);
+    }
+    openFile->Seek(0);
+    for (pos = 0; ok && pos < LargeFileSize; pos += n) {
+	n = min(LargeChunk, LargeFileSize - pos);
+	ok = (openFile->Read(data, n) == n);
+	for (int i = 0; ok && i < n; i++)
+	    ok = (data[i] == Pattern(0, pos + i));
+    }
+    ok = ok && (openFile->Length() == LargeFileSize);
+    delete [] data;
+    delete openFile;
+    ok = kernel->fileSystem->Remove("/large") && ok;
+    printf("Large file test: %d bytes %s\n", LargeFileSize,
+	ok ? "read back" : "NOT read back");
+    return ok;
+}
+
+//----------------------------------------------------------------------
+// LargeDirectoryTest
+// 	Create LargeDirFiles files in one directory, which must grow
+//	well past its first hash table to hold them.  Find them all,
+//	remove every other one, and check that exactly the rest are
+//	still there and intact.
+//----------------------------------------------------------------------
+
+#define LargeDirFiles	3000
+
+static bool
+LargeDirectoryTest()
+{
+    char name[32];
+    int i, made = 0, found = 0, removed = 0, left = 0;
+
+    if (!kernel->fileSystem->Mkdir("/many")) {
+	printf("Large directory test: can't create /many\n");
+	return FALSE;
+    }
+    for (i = 0; i < LargeDirFiles; i++) {
+	sprintf(name, "/many/file%d", i);
+	if (MakeFile(name, i, i % 100))
+	    made++;
+    }
+    for (i = 0; i < LargeDirFiles; i++) {
+	sprintf(name, "/many/file%d", i);
+	if (CheckFile(name, i, i % 100))
+	    found++;
+    }
+    for (i = 0; i < LargeDirFiles; i += 2) {
+	sprintf(name, "/many/file%d", i);
+	if (kernel->fileSystem->Remove(name))
+	    removed++;
+    }
+    for (i = 0; i < LargeDirFiles; i++) {
+	sprintf(name, "/many/file%d", i);
+	if (CheckFile(name, i, i % 100) == (i % 2 == 1))
+	    left++;
+    }
+    for (i = 1; i < LargeDirFiles; i += 2) {
+	sprintf(name, "/many/file%d", i);
+	kernel->fileSystem->Remove(name);
+    }
+    printf("Large directory test: created %d, found %d, removed %d, "
+	"%d of %d right afterwards\n", made, found, removed, left,
+	LargeDirFiles);
+    return made == LargeDirFiles && found == LargeDirFiles
+	&& removed == LargeDirFiles / 2 && left == LargeDirFiles
+	&& kernel->fileSystem->Remove("/many");
+}
+
+//----------------------------------------------------------------------
+// MetadataCacheTest
+// 	Open a file three directories down, then open it WarmOpens more
+//	times.  With its path and header cached, those opens must not
+//	touch a single sector, not even in the buffer cache.
+//----------------------------------------------------------------------
+
+#define WarmOpens	100
+
+static bool
+MetadataCacheTest()
+{
+    OpenFile *openFile;
+    int i, sectors, opened = 0;
+    bool ok = kernel->fileSystem->Mkdir("/x")
+	&& kernel->fileSystem->Mkdir("/x/y")
+	&& kernel->fileSystem->Mkdir("/x/y/z")
+	&& MakeFile("/x/y/z/warm", 0, SectorSize);
+
+    delete kernel->fileSystem->Open("/x/y/z/warm");
+    sectors = kernel->stats->numCacheHits + kernel->stats->numCacheMisses;
+    for (i = 0; ok && i < WarmOpens; i++) {
+	if ((openFile = kernel->fileSystem->Open("/x/y/z/warm")) != NULL)
+	    opened++;
+	delete openFile;
+    }
+    sectors = kernel->stats->numCacheHits + kernel->stats->numCacheMisses
+		- sectors;
+    ok = ok && kernel->fileSystem->Remove("/x/y/z/warm")
+	&& kernel->fileSystem->Remove("/x/y/z")
+	&& kernel->fileSystem->Remove("/x/y")
+	&& kernel->fileSystem->Remove("/x");
+    printf("Metadata cache test: %d of %d opens, %d sectors touched\n",
+	opened, WarmOpens, sectors);
+    return ok && opened == WarmOpens && sectors == 0;
+}
+
+//----------------------------------------------------------------------
+// AgingTest
+// 	Create and remove files of mixed sizes in several directories,
+//	as a disk in use for a while would see, leaving holes in the
+//	free map for later files to be fitted into.  Then check that
+//	every file left still reads back correctly.
+//----------------------------------------------------------------------
+
+static int agingSizes[] = { 300, 1500, 4000, 700, 9000 };
+
+static bool
+AgingTest()
+{
+    char name[32];
+    int i, bad = 0, n = sizeof(agingSizes) / sizeof(agingSizes[0]);
+
+    kernel->fileSystem->Mkdir("/a");
+    kernel->fileSystem->Mkdir("/b");
+    kernel->fileSystem->Mkdir("/c");
+    for (i = 0; i < 120; i++) {		// interleave /a and /b
+	sprintf(name, "/a/f%d", i);
+	bad += !MakeFile(name, i, agingSizes[i % n]);
+	sprintf(name, "/b/f%d", i);
+	bad += !MakeFile(name, i, agingSizes[(i + 2) % n]);
+    }
+    for (i = 0; i < 120; i += 3) {	// leave holes
+	sprintf(name, "/b/f%d", i);
+	bad += !kernel->fileSystem->Remove(name);
+    }
+    for (i = 0; i < 60; i++) {		// and fill them
+	sprintf(name, "/c/f%d", i);
+	bad += !MakeFile(name, i, agingSizes[(i + 1) % n]);
+    }
+    for (i = 0; i < 120; i++) {
+	sprintf(name, "/a/f%d", i);
+	bad += !CheckFile(name, i, agingSizes[i % n]);
+	sprintf(name, "/b/f%d", i);
+	if (i % 3 != 0)
+	    bad += !CheckFile(name, i, agingSizes[(i + 2) % n]);
+    }
+    for (i = 0; i < 60; i++) {
+	sprintf(name, "/c/f%d", i);
+	bad += !CheckFile(name, i, agingSizes[(i + 1) % n]);
+    }
+    printf("Aging test: %d bad\n", bad);
+    return bad == 0;
+}
+
+//----------------------------------------------------------------------
+// RandomAccessTest
+// 	Do RandomIters random, unaligned ReadAt and WriteAt calls on a
+//	file, some short and some spanning several sectors, and check
+//	each read against a copy of the file kept in memory.
+//----------------------------------------------------------------------
+
+#define RandomFileSize	(64 * 1024)
+#define RandomIters	1000
+
+static bool
+RandomAccessTest()
+{
+    OpenFile *openFile;
+    char *mirror, *data, *got;
+    int i, pos, len, bad = 0;
+
+    if (!kernel->fileSystem->Create("/random", RandomFileSize)
+	    || (openFile = kernel->fileSystem->Open("/random")) == NULL) {
+	printf("Random access test: can't create /random\n");
+	return FALSE;
+    }
+    mirror = new char[RandomFileSize];
+    data = new char[RandomFileSize];
+    got = new char[RandomFileSize + 100];
+    bzero(mirror, RandomFileSize);
+    openFile->WriteAt(mirror, RandomFileSize, 0);
+    for (i = 0; i < RandomIters; i++) {
+	pos = RandomNumber() % RandomFileSize;
+	len = RandomNumber() % ((i % 3 == 0) ? 5000 : 300);	// some long
+	len = min(len, RandomFileSize - pos);
+	if (i % 2) {
+	    for (int j = 0; j < len; j++)
+		data[j] = Pattern(i, j);
+	    if (openFile->WriteAt(data, len, pos) != len)
+		bad++;
+	    bcopy(data, mirror + pos, len);
+	} else if (openFile->ReadAt(got, len, pos) != len
+		   || memcmp(got, mirror + pos, len) != 0) {
+	    bad++;
+	}
+    }
+    if (openFile->ReadAt(got, RandomFileSize + 100, 0) != RandomFileSize
+	    || memcmp(got, mirror, RandomFileSize) != 0)
+	bad++;				// reading past the end stops there
+    delete [] mirror;
+    delete [] data;
+    delete [] got;
+    delete openFile;
+    kernel->fileSystem->Remove("/random");
+    printf("Random access test: %d reads and writes, %d bad\n",
+	RandomIters, bad);
+    return bad == 0;
+}
+
+//----------------------------------------------------------------------
+// ChurnWorker
+// 	One of ChurnThreads threads that between them create ChurnFiles
+//	files in one directory, removing every fourth one again right
+//	away, so that creates and removes from different threads are in
+//	progress at once.  File i holds Pattern(i, ...).
+//----------------------------------------------------------------------
+
+#define ChurnThreads	4
+#define ChurnFiles	40
+#define ChurnKept	(ChurnFiles - ChurnFiles / 4)
+
+static char *churnDir;			// where the files go
+static int churnPause;			// timer interrupts between files
+static int churnBad;			// operations that failed
+static Semaphore *churnDone;		// V'd by each worker when done
+
+static int
+ChurnSize(int file)
+{
+    return (file % 3 + 1) * SectorSize - file;	// 1 to 3 sectors
+}
+
+static bool
+ChurnRemoved(int file)
+{
+    return file % 4 == 3;
+}
+
+static void
+ChurnWorker(int worker)
+{
+    char name[32];
+
+    for (int i = worker; i < ChurnFiles; i += ChurnThreads) {
+	sprintf(name, "%s/f%d", churnDir, i);
+	if (!MakeFile(name, i, ChurnSize(i))
+		|| (ChurnRemoved(i) && !kernel->fileSystem->Remove(name)))
+	    churnBad++;
+	if (churnPause > 0)
+	    kernel->alarm->WaitUntil(churnPause);
+    }
+    churnDone->V();
+}
+
+//----------------------------------------------------------------------
+// Churn
+// 	Run the workers in the directory "dir", pausing "pause" timer
+//	interrupts after each file, and wait for them all.  Return how
+//	many of their operations failed.
+//----------------------------------------------------------------------
+
+static int
+Churn(char *dir, int pause)
+{
+    int i;
+
+    churnDir = dir;
+    churnPause = pause;
+    churnBad = 0;
+    churnDone = new Semaphore("churn test", 0);
+    for (i = 0; i < ChurnThreads; i++) {
+	Thread *t = new Thread("churn test");
+	t->Fork((VoidFunctionPtr) ChurnWorker, (void *) (long) i);
+    }
+    for (i = 0; i < ChurnThreads; i++)
+	churnDone->P();
+    delete churnDone;
+    return churnBad;
+}
+
+//----------------------------------------------------------------------
+// CheckChurn
+// 	Count the files Churn kept in "dir" that hold their data, and the
+//	ones it removed that are there after all.  Then remove them all,
+//	and "dir" too.  Returns FALSE if "dir" can't be removed.
+//----------------------------------------------------------------------
+
+static bool
+CheckChurn(char *dir, int *kept, int *back)
+{
+    char name[32];
+    OpenFile *openFile;
+
+    *kept = *back = 0;
+    for (int i = 0; i < ChurnFiles; i++) {
+	sprintf(name, "%s/f%d", dir, i);
+	if (ChurnRemoved(i)) {
+	    if ((openFile = kernel->fileSystem->Open(name)) != NULL) {
+		(*back)++;
+		delete openFile;
+	    }
+	} else if (CheckFile(name, i, ChurnSize(i))) {
+	    (*kept)++;
+	}
+	kernel->fileSystem->Remove(name);
+    }
+    return kernel->fileSystem->Remove(dir);
+}
+
+//----------------------------------------------------------------------
+// ConcurrentTest
+// 	Create and remove files from several threads at once.  No file
+//	may be lost or come back, and once they are all removed, every
+//	sector they used must be free again.
+//----------------------------------------------------------------------
+
+static bool
+ConcurrentTest()
+{
+    int free = kernel->fileSystem->FreeSectors();
+    int bad, kept, back, leaked;
+
+    if (!kernel->fileSystem->Mkdir("/churn")) {
+	printf("Concurrent test: can't create /churn\n");
+	return FALSE;
+    }
+    bad = Churn("/churn", 0);
+    bad += !CheckChurn("/churn", &kept, &back);
+    leaked = free - kernel->fileSystem->FreeSectors();
+    printf("Concurrent test: %d threads, %d failed, %d of %d files intact, "
+	"%d removed ones back, %d sectors leaked\n", ChurnThreads, bad,
+	kept, ChurnKept, back, leaked);
+    return bad == 0 && kept == ChurnKept && back == 0 && leaked == 0;
+}
+
+static bool (*selfTests[])() = {
+    BufferCacheTest,
+    DiskQueueTest,
+    MultiSectorTest,
+    LargeFileTest,
+    LargeDirectoryTest,
+    MetadataCacheTest,
+    AgingTest,
+    RandomAccessTest,
+    ConcurrentTest,
+};
+
+void
+FileSysSelfTest()
+{
+    int n = sizeof(selfTests) / sizeof(selfTests[0]);
+    int failed = 0;
+
+    for (int i = 0; i < n; i++)
+	failed += !(*selfTests[i])();
+    kernel->fileSystem->Sync();
+    printf("FileSysSelfTest: %d of %d tests failed\n", failed, n);
+    ASSERT(failed == 0);
+}
+
+//----------------------------------------------------------------------
+// JournalCrashTest
+// 	Have ChurnThreads threads create, fill and remove files at once,
+//	a few time slices apart, and then halt without calling Sync --
+//	as if the power went out.  Nothing but the journal's committer
+//	thread can have saved the new directory entries, and nothing but
+//	the buffer cache's flusher thread the data in the files.  Run
+//	JournalReplayTest on the same disk (nachos -fsreplay) to check
+//	that all of it survived.
+//
+//	How many sectors were free before is recorded in CrashFree.
+//
+//	Does not return.
+//----------------------------------------------------------------------
+
+#define CrashDir	"/crash"
+#define CrashFree	"/crash.free"
+#define CrashSettle	10000	// timer interrupts to wait before halting
+
+void
+JournalCrashTest()
+{
+    OpenFile *openFile;
+    int free, bad;
+
+    if (!kernel->fileSystem->Create(CrashFree, sizeof(int))
+	    || (openFile = kernel->fileSystem->Open(CrashFree)) == NULL) {
+	printf("Crash test: can't create %s\n", CrashFree);
+	kernel->interrupt->Halt();
+    }
+    free = kernel->fileSystem->FreeSectors();
+    openFile->WriteAt((char *) &free, sizeof(int), 0);
+    delete openFile;
+    kernel->fileSystem->Sync();		// the count must survive
+    if (!kernel->fileSystem->Mkdir(CrashDir)) {
+	printf("Crash test: can't create %s\n", CrashDir);
+	kernel->interrupt->Halt();
+    }
+    bad = Churn(CrashDir, JournalCommitInterval / 2);
+    // give the last operations time to be committed; a commit may
+    // have to seek across the whole disk to the log and back
+    kernel->alarm->WaitUntil(CrashSettle);
+    printf("Crash test: %d threads created %d files and removed %d, "
+	"%d failed, halting without Sync\n", ChurnThreads, ChurnFiles,
+	ChurnFiles - ChurnKept, bad);
+    kernel->interrupt->Halt();
+}
+
+//----------------------------------------------------------------------
+// JournalReplayTest
+// 	Check the files JournalCrashTest left, on the disk as mounted
+//	(and its journal replayed): the ones it kept must be there with
+//	their data, and the ones it removed must be gone.  Then remove
+//	them all; every sector that was free before the crash test must
+//	be free again.  Run the crash test again before the next replay.
+//----------------------------------------------------------------------
+
+void
+JournalReplayTest()
+{
+    OpenFile *openFile = kernel->fileSystem->Open(CrashFree);
+    int free, kept, back, leaked;
+    bool removed;
+
+    if (openFile == NULL
+	    || openFile->ReadAt((char *) &free, sizeof(int), 0) != sizeof(int)) {
+	printf("Replay test: no %s; run nachos -fscrash first\n", CrashFree);
+	delete openFile;
+	return;
+    }
+    delete openFile;
+    removed = CheckChurn(CrashDir, &kept, &back);
+    leaked = free - kernel->fileSystem->FreeSectors();
+    kernel->fileSystem->Remove(CrashFree);
+    kernel->fileSystem->Sync();
+    printf("Replay test: %d of %d files intact, %d removed ones back, "
+	"%d sectors leaked\n", kept, ChurnKept, back, leaked);
+    ASSERT(removed && kept == ChurnKept && back == 0 && leaked == 0);
+}
@@ -0,0 +1,627 @@
+// journal.cc
+//	Routines to manage the metadata journal.  See journal.h.
+//
+//	The log is a circular array of sectors.  Each commit writes,
+//	starting at "head":
+//
+//	   one or more descriptors, each listing the home sectors of
+//		the images that follow it
+//	   the images
+//	   a commit record
+//
+//	all tagged with the commit's sequence number.  The descriptors
+//	and images go to the disk together, in one gather write; the
+//	commit record is written only after they are all there, so a
+//	commit record in the log means the whole transaction is.
+//
+//	The superblock, the first sector of the journal file, says where
+//	the oldest commit not yet checkpointed starts, and its number.
+//	Replay follows the log from there for as long as it finds
+//	complete transactions with the next number in turn.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "main.h"
+#include "journal.h"
+#include "filehdr.h"
+#include "synchdisk.h"
+#include "synch.h"
+
+const int SuperMagic = 0x4a524e4c;		// "JRNL"
+const int DescriptorMagic = 0x44455343;		// "DESC"
+const int CommitMagic = 0x434f4d54;		// "COMT"
+
+#define SectorsPerDescriptor	((int) (SectorSize / sizeof(int)) - 3)
+
+// A sector of the log that isn't an image: the superblock, a
+// descriptor, or a commit record.  For the superblock, "count" is the
+// position in the log of the tail; for a commit record, it is the
+// number of images committed.
+
+class JournalRecord {
+  public:
+    int magic;
+    int seq;
+    int count;
+    int sectors[SectorsPerDescriptor];	// descriptors only
+};
+
+//----------------------------------------------------------------------
+// BlockKey, HashSector
+// 	What the hash table needs to know about journal blocks and
+//	sectors.
+//----------------------------------------------------------------------
+
+static int
+BlockKey(JournalBlock *block)
+{
+    return block->sector;
+}
+
+static unsigned
+HashSector(int sector)
+{
+    return (unsigned) sector;
+}
+
+//----------------------------------------------------------------------
+// JournalCommitter
+// 	Start the committer thread.  Needed because Fork won't call a
+//	member function.
+//----------------------------------------------------------------------
+
+static void
+JournalCommitter(Journal *journal)
+{
+    journal->Committer();
+}
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Find the log, in the journal file whose header is at
+//	"hdrSector".  Call Format or Replay before using it.
+//
+//	"synchDisk" -- where the log and the sectors it logs are
+//----------------------------------------------------------------------
+
+Journal::Journal(SynchDisk *synchDisk, int hdrSector)
+{
+    FileHeader *hdr = new FileHeader;
+
+    ASSERT(sizeof(JournalRecord) == SectorSize);
+    disk = synchDisk;
+    hdr->FetchFrom(hdrSector);
+    superSector = hdr->ByteToSector(0);
+    logSize = hdr->FileLength() / SectorSize - 1;
+    logSectors = new int[logSize];
+    for (int i = 0; i < logSize; i++)
+	logSectors[i] = hdr->ByteToSector((i + 1) * SectorSize);
+    delete hdr;
+
+    head = tail = used = 0;
+    headSeq = tailSeq = 1;
+    blocks = new HashTable<int, JournalBlock *>(BlockKey, HashSector);
+    numRunning = numCommitted = 0;
+    active = new List<Thread *>;
+    draining = writing = committerRunning = FALSE;
+    lock = new Lock("journal lock");
+    changed = new Condition("journal changed");
+}
+
+//----------------------------------------------------------------------
+// Journal::~Journal
+// 	Nachos is halting.  Whatever is committed is safe in the log;
+//	whatever is still running is lost.
+//----------------------------------------------------------------------
+
+Journal::~Journal()
+{
+    List<JournalBlock *> all;
+    HashIterator<int, JournalBlock *> iter(blocks);
+
+    for (; !iter.IsDone(); iter.Next())
+	all.Append(iter.Item());
+    while (!all.IsEmpty()) {
+	JournalBlock *block = all.RemoveFront();
+
+	blocks->Remove(block->sector);
+	delete block;
+    }
+    delete blocks;
+    delete [] logSectors;
+    delete active;
+    delete lock;
+    delete changed;
+}
+
+//----------------------------------------------------------------------
+// Journal::Format
+// 	Start with an empty log.  Its first sector is cleared, so that
+//	nothing left over from before looks like a transaction; and if
+//	there was a journal here before, numbering carries on past
+//	anything it can have written.
+//----------------------------------------------------------------------
+
+void
+Journal::Format()
+{
+    int buf[SectorSize / sizeof(int)];
+    JournalRecord *rec = (JournalRecord *) buf;
+
+    disk->ReadSector(superSector, (char *) buf);
+    if (rec->magic == SuperMagic && rec->seq > 0)
+	headSeq = rec->seq + logSize;
+    else
+	headSeq = 1;
+    tailSeq = headSeq;
+    head = tail = used = 0;
+
+    bzero((char *) buf, SectorSize);
+    disk->WriteSector(logSectors[0], (char *) buf);
+    WriteSuper();
+}
+
+//----------------------------------------------------------------------
+// Journal::Scan
+// 	Follow the log from the tail.  Return how many of its sectors
+//	hold complete transactions, and set "endSeq" to the number the
+//	next one would have.
+//----------------------------------------------------------------------
+
+int
+Journal::Scan(int *endSeq)
+{
+    int buf[SectorSize / sizeof(int)];
+    JournalRecord *rec = (JournalRecord *) buf;
+    int pos = 0, end = 0, seq = tailSeq;
+
+    while (pos < logSize) {
+	disk->ReadSector(logSectors[(tail + pos) % logSize], (char *) buf);
+	if (rec->seq != seq)
+	    break;
+	if (rec->magic == CommitMagic) {
+	    end = ++pos;
+	    seq++;
+	} else if (rec->magic == DescriptorMagic && rec->count > 0
+			&& rec->count <= SectorsPerDescriptor
+			&& pos + 1 + rec->count < logSize) {
+	    pos += 1 + rec->count;
+	} else
+	    break;
+    }
+    *endSeq = seq;
+    return end;
+}
+
+//----------------------------------------------------------------------
+// Journal::Replay
+// 	The disk is being mounted.  Copy every image in a complete
+//	transaction in the log to its home, oldest first, and then start
+//	the log afresh after them.  A transaction without its commit
+//	record was cut short by a crash, and is ignored.
+//----------------------------------------------------------------------
+
+void
+Journal::Replay()
+{
+    int buf[SectorSize / sizeof(int)];
+    JournalRecord *rec = (JournalRecord *) buf;
+    int from[SectorsPerDescriptor];
+    char *data[SectorsPerDescriptor];
+    char *images = new char[SectorsPerDescriptor * SectorSize];
+    int pos, end, endSeq, applied = 0;
+
+    disk->ReadSector(superSector, (char *) buf);
+    if (rec->magic != SuperMagic || rec->count < 0
+		|| rec->count >= logSize) {	// never had a journal
+	Format();
+	delete [] images;
+	return;
+    }
+    tail = rec->count;
+    tailSeq = rec->seq;
+    end = Scan(&endSeq);
+
+    for (pos = 0; pos < end; ) {
+	disk->ReadSector(logSectors[(tail + pos) % logSize], (char *) buf);
+	pos++;
+	if (rec->magic != DescriptorMagic)
+	    continue;
+	for (int i = 0; i < rec->count; i++) {
+	    from[i] = logSectors[(tail + pos + i) % logSize];
+	    data[i] = &images[i * SectorSize];
+	}
+	disk->ReadScatter(from, data, rec->count);
+	disk->WriteGather(rec->sectors, data, rec->count);
+	applied += rec->count;
+	pos += rec->count;
+    }
+    DEBUG(dbgFile, "Journal replayed " << endSeq - tailSeq
+		<< " transactions, " << applied << " sectors");
+    delete [] images;
+
+    head = tail = (tail + end) % logSize;
+    headSeq = tailSeq = endSeq;
+    used = 0;
+    WriteSuper();
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin
+// 	The current thread is starting an operation; what it writes
+//	until End goes into the running transaction.  Waits while a
+//	commit is waiting for operations to end, and commits first if
+//	the running transaction is getting too big.
+//----------------------------------------------------------------------
+
+void
+Journal::Begin()
+{
+    lock->Acquire();
+    ASSERT(!active->IsInList(kernel->currentThread));
+    while (draining || numRunning >= JournalMaxRunning) {
+	if (draining)
+	    changed->Wait(lock);
+	else
+	    DoCommit();
+    }
+    active->Append(kernel->currentThread);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::End
+// 	The current thread's operation is complete.  It will be
+//	committed along with the rest of the running transaction; this
+//	does not wait for that.
+//----------------------------------------------------------------------
+
+void
+Journal::End()
+{
+    lock->Acquire();
+    active->Remove(kernel->currentThread);
+    changed->Broadcast(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::InOperation
+// 	Return TRUE if the current thread is in an operation, so that
+//	what it writes will be logged.
+//----------------------------------------------------------------------
+
+bool
+Journal::InOperation()
+{
+    bool in;
+
+    lock->Acquire();
+    in = active->IsInList(kernel->currentThread);
+    lock->Release();
+    return in;
+}
+
+//----------------------------------------------------------------------
+// Journal::Log
+// 	Called by the buffer cache for every sector written.  If the
+//	current thread is in an operation, keep "data" as the newest
+//	image of "sector" in the running transaction and return TRUE;
+//	the cache need not write it.  Otherwise return FALSE.
+//----------------------------------------------------------------------
+
+bool
+Journal::Log(int sector, char *data)
+{
+    JournalBlock *block;
+
+    lock->Acquire();
+    if (!active->IsInList(kernel->currentThread)) {
+	lock->Release();
+	return FALSE;
+    }
+    if (!blocks->Find(sector, &block)) {
+	block = new JournalBlock;
+	block->sector = sector;
+	block->running = block->committed = FALSE;
+	blocks->Insert(block);
+    }
+    if (!block->running) {
+	block->running = TRUE;
+	numRunning++;
+    }
+    bcopy(data, block->data, SectorSize);
+    if (!committerRunning) {
+	Thread *t = new Thread("journal committer");
+
+	committerRunning = TRUE;
+	t->Fork((VoidFunctionPtr) JournalCommitter, (void *) this);
+    }
+    lock->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Journal::Read
+// 	If the journal has a newer image of "sector" than its home on
+//	disk, copy it into "data" and return TRUE.
+//----------------------------------------------------------------------
+
+bool
+Journal::Read(int sector, char *data)
+{
+    JournalBlock *block;
+    bool found;
+
+    lock->Acquire();
+    found = blocks->Find(sector, &block);
+    if (found)
+	bcopy(block->running ? block->data : block->committedData,
+						data, SectorSize);
+    lock->Release();
+    return found;
+}
+
+//----------------------------------------------------------------------
+// Journal::Revoke
+// 	"sector" is about to be written in place, outside any operation
+//	(it has been freed, and reused for file data).  Forget any
+//	image of it: one in the running transaction is simply dropped;
+//	one already in the log is checkpointed first, so that replay
+//	will never copy it over the new contents.
+//----------------------------------------------------------------------
+
+void
+Journal::Revoke(int sector)
+{
+    JournalBlock *block;
+
+    lock->Acquire();
+    while (draining || writing)
+	changed->Wait(lock);
+    if (blocks->Find(sector, &block)) {
+	if (block->committed) {
+	    writing = TRUE;
+	    DoCheckpoint();
+	    writing = FALSE;
+	    changed->Broadcast(lock);
+	}
+	if (blocks->Find(sector, &block)) {	// still running
+	    ASSERT(block->running && !block->committed);
+	    blocks->Remove(sector);
+	    numRunning--;
+	    delete block;
+	}
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Commit
+// 	Wait for the operations in progress to end, and write the
+//	running transaction to the log.
+//----------------------------------------------------------------------
+
+void
+Journal::Commit()
+{
+    lock->Acquire();
+    DoCommit();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Checkpoint
+// 	Commit, and then write every committed image to its home on
+//	disk, leaving the log empty.
+//----------------------------------------------------------------------
+
+void
+Journal::Checkpoint()
+{
+    lock->Acquire();
+    DoCommit();
+    while (draining || writing)
+	changed->Wait(lock);
+    writing = TRUE;
+    DoCheckpoint();
+    writing = FALSE;
+    changed->Broadcast(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Committer
+// 	Commit every JournalCommitInterval timer interrupts, for as long
+//	as operations keep writing.  Like the buffer cache's flusher,
+//	the thread then finishes; Log starts a new one when needed.
+//----------------------------------------------------------------------
+
+void
+Journal::Committer()
+{
+    lock->Acquire();
+    while (numRunning > 0) {
+	lock->Release();
+	kernel->alarm->WaitUntil(JournalCommitInterval);
+	lock->Acquire();
+	DoCommit();
+    }
+    committerRunning = FALSE;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::DoCommit
+// 	Commit the running transaction.  Called, and returns, with the
+//	lock held; gives it up while writing.
+//
+//	While "draining" is set, no operation can begin, so once the
+//	active ones end, the running images stay put while we copy
+//	them for the log.  From then on operations can begin again,
+//	and write new images, while the copies are written out.  If
+//	the log has no room, everything in it is checkpointed first.
+//----------------------------------------------------------------------
+
+void
+Journal::DoCommit()
+{
+    int buf[SectorSize / sizeof(int)];
+    JournalRecord *commit = (JournalRecord *) buf;
+    JournalRecord *records, *desc = NULL;
+    int *sectors;
+    char **data;
+    int n, numDesc, need, pos = 0;
+
+    while (draining || writing)		// one commit at a time
+	changed->Wait(lock);
+    if (numRunning == 0)
+	return;
+    draining = TRUE;
+    while (!active->IsEmpty())
+	changed->Wait(lock);
+    writing = TRUE;
+
+    n = numRunning;
+    numDesc = divRoundUp(n, SectorsPerDescriptor);
+    need = numDesc + n + 1;
+    ASSERT(need <= logSize);
+    if (logSize - used < need)
+	DoCheckpoint();
+
+    records = new JournalRecord[numDesc];
+    sectors = new int[need];
+    data = new char *[need];
+    HashIterator<int, JournalBlock *> iter(blocks);
+    for (; !iter.IsDone(); iter.Next()) {
+	JournalBlock *block = iter.Item();
+
+	if (!block->running)
+	    continue;
+	if (desc == NULL || desc->count == SectorsPerDescriptor) {
+	    desc = (desc == NULL) ? records : desc + 1;
+	    desc->magic = DescriptorMagic;
+	    desc->seq = headSeq;
+	    desc->count = 0;
+	    sectors[pos] = logSectors[(head + pos) % logSize];
+	    data[pos++] = (char *) desc;
+	}
+	desc->sectors[desc->count++] = block->sector;
+	bcopy(block->data, block->committedData, SectorSize);
+	block->running = FALSE;
+	if (!block->committed) {
+	    block->committed = TRUE;
+	    numCommitted++;
+	}
+	sectors[pos] = logSectors[(head + pos) % logSize];
+	data[pos++] = block->committedData;
+    }
+    ASSERT(pos == need - 1);
+    numRunning = 0;
+    draining = FALSE;
+    changed->Broadcast(lock);
+
+    bzero((char *) buf, SectorSize);
+    commit->magic = CommitMagic;
+    commit->seq = headSeq;
+    commit->count = n;
+    DEBUG(dbgFile, "Journal committing " << headSeq << ": " << n << " sectors");
+    lock->Release();
+    disk->WriteGather(sectors, data, pos);
+    disk->WriteSector(logSectors[(head + pos) % logSize], (char *) buf);
+    lock->Acquire();
+
+    head = (head + need) % logSize;
+    used += need;
+    headSeq++;
+    delete [] records;
+    delete [] sectors;
+    delete [] data;
+    writing = FALSE;
+    changed->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// Journal::DoCheckpoint
+// 	Write every committed image home, in one gather write in sector
+//	order, and then move the tail of the log up to the head.  Called
+//	with the lock held and "writing" set; gives up the lock while
+//	writing.
+//----------------------------------------------------------------------
+
+void
+Journal::DoCheckpoint()
+{
+    JournalBlock **batch;
+    int *sectors;
+    char **data;
+    int i, j, k = 0;
+
+    if (used == 0)
+	return;
+    if (numCommitted > 0) {
+	batch = new JournalBlock *[numCommitted];
+	sectors = new int[numCommitted];
+	data = new char *[numCommitted];
+	HashIterator<int, JournalBlock *> iter(blocks);
+	for (; !iter.IsDone(); iter.Next()) {
+	    JournalBlock *block = iter.Item();
+
+	    if (!block->committed)
+		continue;
+	    for (j = k; j > 0 && batch[j - 1]->sector > block->sector; j--)
+		batch[j] = batch[j - 1];	// insertion sort by sector
+	    batch[j] = block;
+	    k++;
+	}
+	ASSERT(k == numCommitted);
+	for (i = 0; i < k; i++) {
+	    sectors[i] = batch[i]->sector;
+	    data[i] = batch[i]->committedData;
+	}
+
+	DEBUG(dbgFile, "Journal checkpointing " << k << " sectors");
+	lock->Release();
+	disk->WriteGather(sectors, data, k);
+	lock->Acquire();
+
+	for (i = 0; i < k; i++) {
+	    batch[i]->committed = FALSE;
+	    if (!batch[i]->running) {
+		blocks->Remove(batch[i]->sector);
+		delete batch[i];
+	    }
+	}
+	numCommitted = 0;
+	delete [] batch;
+	delete [] sectors;
+	delete [] data;
+    }
+    tail = head;
+    tailSeq = headSeq;
+    used = 0;
+    lock->Release();
+    WriteSuper();
+    lock->Acquire();
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteSuper
+// 	Record where the log now starts.
+//----------------------------------------------------------------------
+
+void
+Journal::WriteSuper()
+{
+    int buf[SectorSize / sizeof(int)];
+    JournalRecord *rec = (JournalRecord *) buf;
+
+    bzero((char *) buf, SectorSize);
+    rec->magic = SuperMagic;
+    rec->seq = tailSeq;
+    rec->count = tail;
+    disk->WriteSector(superSector, (char *) buf);
+}
@@ -0,0 +1,129 @@
+// journal.h
+//	Data structures for the metadata journal: a circular log on
+//	disk of the sectors that file system operations change, so that
+//	an operation cut short by a crash is either redone in full, or
+//	not at all, when the disk is next mounted.
+//
+//	An operation (such as Create) is bracketed by Begin and End.
+//	Every sector the thread writes in between goes into the running
+//	transaction, in memory, instead of being marked dirty in the
+//	buffer cache.  Every JournalCommitInterval timer interrupts, or
+//	sooner if it gets big, the running transaction is committed:
+//	once the operations in it have all ended, its sectors are
+//	written to the log one after the other, and then a commit
+//	record after them.  New operations wait only for that first
+//	part; while the log is being written, they go into the next
+//	transaction.  Many operations, from any number of threads,
+//	share each commit -- a "group commit" -- so the log costs a
+//	couple of sequential disk requests per interval, rather than a
+//	scattered write per sector per operation.
+//
+//	Committed sectors reach their home on disk only when the log
+//	needs the room, or on Sync (a "checkpoint"); until then, reads
+//	of them are served from the journal.  Mounting the disk replays
+//	whatever the log holds that was committed and not checkpointed.
+//
+//	File data is not journaled.  A sector written outside an
+//	operation is "revoked": taken out of the journal, so that a
+//	replay can never overwrite it with an older metadata image.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "copyright.h"
+#include "disk.h"
+#include "hash.h"
+#include "list.h"
+
+class SynchDisk;
+class Lock;
+class Condition;
+class Thread;
+
+const int JournalFileSize = 1024 * SectorSize;
+					// the log, and a superblock saying
+					// where it starts
+const int JournalCommitInterval = 10;	// timer interrupts between commits
+const int JournalMaxRunning = 256;	// sectors in the running transaction
+					// that make Begin commit it first
+
+// One sector the journal has a newer copy of than its home on disk.
+// It may be in the running transaction, in a committed one that has
+// not been checkpointed yet, or both, with different contents.
+
+class JournalBlock {
+  public:
+    int sector;			// home of the sector on disk
+    bool running;		// "data" is in the running transaction
+    bool committed;		// "committedData" is in the log, or
+				//  being written there
+    char data[SectorSize];
+    char committedData[SectorSize];
+};
+
+// The journal.  It keeps its log in a file, whose header is at
+// "hdrSector"; the log's sectors are read and written directly,
+// not through the buffer cache.
+
+class Journal {
+  public:
+    Journal(SynchDisk *synchDisk, int hdrSector);
+    ~Journal();
+
+    void Format();			// start with an empty log
+    void Replay();			// redo the committed transactions
+					// found in the log
+
+    void Begin();			// start an operation
+    void End();				// the operation is done
+    bool InOperation();			// is the current thread between
+					// Begin and End?
+    bool Log(int sector, char *data);	// if the current thread is in an
+					// operation, journal "data" as the
+					// new contents of "sector"
+    bool Read(int sector, char *data);	// copy the journal's newest image
+					// of "sector", if it has one
+    void Revoke(int sector);		// "sector" is being written in place
+    void Commit();			// commit the running transaction
+    void Checkpoint();			// commit, then write everything
+					// committed to its home
+
+    void Committer();			// body of the committer thread
+
+  private:
+    SynchDisk *disk;
+    int superSector;			// where the log starts and ends
+    int *logSectors;			// the log, in order
+    int logSize;
+    int head;				// where the next commit goes
+    int tail;				// the oldest thing in the log that
+					// has not been checkpointed
+    int used;				// log sectors from tail to head
+    int headSeq;			// number of the next commit
+    int tailSeq;			// ... and of the one at "tail"
+
+    HashTable<int, JournalBlock *> *blocks;	// by sector
+    int numRunning;			// blocks in the running transaction
+    int numCommitted;			// blocks committed but not home yet
+    List<Thread *> *active;		// threads between Begin and End
+    bool draining;			// a commit is waiting for the
+					// active operations to end
+    bool writing;			// a commit or checkpoint is writing
+    bool committerRunning;
+    Lock *lock;				// protects everything above
+    Condition *changed;			// "draining", "writing" or "active"
+					// changed
+
+    void DoCommit();			// write the running transaction to
+					// the log
+    void DoCheckpoint();		// write the committed blocks home
+    void WriteSuper();			// record "tail" and "tailSeq"
+    int Scan(int *endSeq);		// find the end of the complete
+					// transactions in the log
+};
+
+#endif // JOURNAL_H
@@ -5,7 +5,11 @@
 //	the OpenFile data structure).
 //
 //	Also as in UNIX, for convenience, we keep the file header in
-//	memory while the file is open.
+//	memory while the file is open.  It comes from the inode cache,
+//	so all the OpenFiles on a file share one copy.
+//
+//	Each OpenFile keeps track of whether it is being read or written
+//	in order, and if so reads ahead or writes behind (cf. openfile.h).
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -18,30 +22,41 @@
 #include "openfile.h"
 #include "debug.h"
 #include "main.h"
+#include "bufcache.h"
+#include "fscache.h"
+#include "pbitmap.h"
 
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 // 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+//	into memory while the file is open, unless it is there already.
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
 OpenFile::OpenFile(int sector)
 { 
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    inode = kernel->inodeCache->Get(sector);
+    hdr = inode->hdr;
     seekPosition = 0;
+    nextPosition = 0;
+    window = 0;
+    aheadStart = aheadEnd = 0;
+    behindSector = -1;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
 // 	Close a Nachos file, de-allocating any in-memory data structures.
+//	The header stays in the inode cache for a while.  Whatever was
+//	last written in order is started on its way to the disk.
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    if (behindSector >= 0)
+	Push(behindSector, divRoundUp(nextPosition, SectorSize));
+    kernel->inodeCache->Release(inode);
 }
 
 //----------------------------------------------------------------------
@@ -64,7 +79,9 @@ OpenFile::Seek(int position)
 //	Return the number of bytes actually written or read, and as a
 //	side effect, increment the current position within the file.
 //
-//	Implemented using the more primitive ReadAt/WriteAt.
+//	Implemented using the more primitive ReadAt/WriteAt.  A Read or
+//	Write that starts where the last one ended is sequential, and
+//	reads ahead or writes behind.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
@@ -74,19 +91,123 @@ OpenFile::Seek(int position)
 int
 OpenFile::Read(char *into, int numBytes)
 {
-   int result = ReadAt(into, numBytes, seekPosition);
+   bool sequential = (seekPosition == nextPosition);
+   int result;
+
+   result = ReadAt(into, numBytes, seekPosition);
+   ReadAhead(seekPosition, result, sequential);
    seekPosition += result;
+   nextPosition = seekPosition;
    return result;
 }
 
 int
 OpenFile::Write(char *into, int numBytes)
 {
-   int result = WriteAt(into, numBytes, seekPosition);
+   bool sequential = (seekPosition == nextPosition);
+   int result;
+
+   result = WriteAt(into, numBytes, seekPosition);
+   // each sector has to be read before it is partly overwritten; if
+   // that is how it is being written, read ahead for that
+   if (numBytes < SectorSize)
+	ReadAhead(seekPosition, result, sequential);
+   WriteBehind(seekPosition, result, sequential);
    seekPosition += result;
+   nextPosition = seekPosition;
    return result;
 }
 
+//----------------------------------------------------------------------
+// OpenFile::ReadAhead
+// 	Called after "numBytes" bytes at "position" have been read (or
+//	partly written).  If the access is sequential, and has reached the
+//	window read ahead last time (or this is the first one), start
+//	reading the next window, twice as big as the last.  Otherwise
+//	start over.
+//
+//	"sequential" -- whether the bytes followed on from the last
+//		access
+//----------------------------------------------------------------------
+
+void
+OpenFile::ReadAhead(int position, int numBytes, bool sequential)
+{
+    int fileSectors = divRoundUp(hdr->FileLength(), SectorSize);
+    int sectors[ReadAheadMax];
+    int last, start, end;
+
+    if (!sequential || numBytes <= 0) {
+	window = 0;
+	return;
+    }
+    last = divRoundDown(position + numBytes - 1, SectorSize);
+    if (window == 0) {
+	window = ReadAheadMin;
+	aheadStart = aheadEnd = last + 1;
+    } else if (last >= aheadStart) {
+	window = min(window * 2, ReadAheadMax);
+    } else {
+	return;			// still short of the last window
+    }
+    start = max(aheadEnd, last + 1);
+    end = min(start + window, fileSectors);
+    if (start >= end)
+	return;
+    for (int i = start; i < end; i++)
+	sectors[i - start] = hdr->ByteToSector(i * SectorSize);
+    kernel->bufferCache->ReadAhead(sectors, end - start);
+    aheadStart = start;
+    aheadEnd = end;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::WriteBehind
+// 	Called after "numBytes" bytes have been written at "position".
+//	If the writes are sequential, the sectors before the one the
+//	next write goes in are finished with; once WriteBehindCluster of
+//	them have built up, write them behind.  Until then they wait in
+//	the buffer cache, so that small writes to a sector are gathered
+//	into one disk write, and neighbouring sectors into one request.
+//----------------------------------------------------------------------
+
+void
+OpenFile::WriteBehind(int position, int numBytes, bool sequential)
+{
+    int done = divRoundDown(position + numBytes, SectorSize);
+
+    if (numBytes <= 0)
+	return;
+    if (!sequential || behindSector < 0)
+	behindSector = divRoundDown(position, SectorSize);
+    if (done - behindSector >= WriteBehindCluster) {
+	Push(behindSector, done);
+	behindSector = done;
+    }
+}
+
+//----------------------------------------------------------------------
+// OpenFile::Push
+// 	Start writing the file's sectors "from" up to (not including)
+//	"to" to disk, WriteBehindCluster at a time.  The buffer cache
+//	skips those that are not cached or not dirty.
+//----------------------------------------------------------------------
+
+void
+OpenFile::Push(int from, int to)
+{
+    int sectors[WriteBehindCluster];
+    int n;
+
+    to = min(to, divRoundUp(hdr->FileLength(), SectorSize));
+    for (; from < to; from += n) {
+	n = min(to - from, WriteBehindCluster);
+	for (int i = 0; i < n; i++)
+	    sectors[i] = hdr->ByteToSector((from + i) * SectorSize);
+	kernel->bufferCache->WriteBehind(sectors, n);
+    }
+}
+
 //----------------------------------------------------------------------
 // OpenFile::ReadAt/WriteAt
 // 	Read/write a portion of a file, starting at "position".
@@ -98,13 +219,17 @@ OpenFile::Write(char *into, int numBytes)
 //	sector at a time.  Thus:
 //
 //	For ReadAt:
-//	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
+//	   The sectors are read through the buffer cache CacheMaxBatch at
+//	   a time, so that runs of them on disk are read as runs, and just
+//	   the bytes we want are copied out of them into the caller's
+//	   buffer.
 //	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
-//	   so that we don't overwrite the unmodified portion.  We then copy
-//	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	   Whole sectors are copied from the caller's buffer into the
+//	   cache.  A partial sector at either end is patched in the cached
+//	   copy, which the cache reads in first if need be.
+//
+//	Nothing is allocated, and each byte is copied only once, between
+//	the caller's buffer and the cache.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
@@ -117,8 +242,8 @@ int
 OpenFile::ReadAt(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
+    int sectors[CacheMaxBatch];
+    int pos, end, first, n, count;
 
     if ((numBytes <= 0) || (position >= fileLength))
     	return 0; 				// check request
@@ -126,19 +251,18 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
 	numBytes = fileLength - position;
     DEBUG(dbgFile, "Reading " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
-    firstSector = divRoundDown(position, SectorSize);
-    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        kernel->synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
-    delete [] buf;
+    // read CacheMaxBatch sectors at a time, copying just the bytes we
+    // want out of them
+    end = position + numBytes;
+    for (pos = position; pos < end; pos += count) {
+	first = divRoundDown(pos, SectorSize);
+	n = min(divRoundUp(end, SectorSize) - first, CacheMaxBatch);
+	count = min(end, (first + n) * SectorSize) - pos;
+	for (int i = 0; i < n; i++)
+	    sectors[i] = hdr->ByteToSector((first + i) * SectorSize);
+	kernel->bufferCache->ReadBytes(sectors, n, pos % SectorSize, count,
+							&into[pos - position]);
+    }
     return numBytes;
 }
 
@@ -146,9 +270,7 @@ int
 OpenFile::WriteAt(char *from, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
-    char *buf;
+    int pos, end, offset, n;
 
     if ((numBytes <= 0) || (position >= fileLength))
 	return 0;				// check request
@@ -156,30 +278,21 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
 	numBytes = fileLength - position;
     DEBUG(dbgFile, "Writing " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
-    firstSector = divRoundDown(position, SectorSize);
-    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    buf = new char[numSectors * SectorSize];
-
-    firstAligned = (position == (firstSector * SectorSize));
-    lastAligned = ((position + numBytes) == ((lastSector + 1) * SectorSize));
-
-// read in first and last sector, if they are to be partially modified
-    if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
-    if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
-
-// copy in the bytes we want to change 
-    bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
-
-// write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)	
-        kernel->synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-    delete [] buf;
+    pos = position;
+    end = position + numBytes;
+    offset = pos % SectorSize;
+    if (offset != 0 || end - pos < SectorSize) {	// partial first sector
+	n = min(SectorSize - offset, end - pos);
+	kernel->bufferCache->WritePart(hdr->ByteToSector(pos), offset, n,
+									from);
+	pos += n;
+    }
+    for (; end - pos >= SectorSize; pos += SectorSize)
+	kernel->bufferCache->WriteSector(hdr->ByteToSector(pos),
+							&from[pos - position]);
+    if (pos < end)					// partial last sector
+	kernel->bufferCache->WritePart(hdr->ByteToSector(pos), 0, end - pos,
+							&from[pos - position]);
     return numBytes;
 }
 
@@ -193,4 +306,24 @@ OpenFile::Length()
 { 
     return hdr->FileLength(); 
 }
+
+//----------------------------------------------------------------------
+// OpenFile::Extend
+// 	Grow the file to "newLength" bytes, taking the space from
+//	"freeMap", as near the end of the file as it can be.  The new
+//	part of the file holds whatever was on the disk.  Return FALSE
+//	if there is not enough room.
+//
+//	The new header is written back with the rest of the inode cache;
+//	the caller is responsible for writing "freeMap" back.
+//----------------------------------------------------------------------
+
+bool
+OpenFile::Extend(PersistBitMap *freeMap, int newLength)
+{
+    if (!hdr->Extend(freeMap, newLength, inode->sector))
+	return FALSE;
+    inode->dirty = TRUE;
+    return TRUE;
+}
 #endif //FILESYS
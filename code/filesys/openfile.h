@@ -60,6 +60,20 @@ class OpenFile {
 
 #else // FILESYS
 class FileHeader;
+class PersistBitMap;
+class Inode;
+
+// Read and Write watch for a file being read or written in order.
+// While it is, the sectors after the ones being read are read ahead
+// into the buffer cache, a window at a time: each time the reader
+// reaches the window read ahead last, the next one, twice as big, is
+// started.  And the sectors a writer has finished with are written
+// behind it, WriteBehindCluster at a time, in one disk request.  So
+// the disk works while the caller does something with the data.
+
+const int ReadAheadMin = 2;		// sectors in the first window
+const int ReadAheadMax = 8;		// ... and the most in one
+const int WriteBehindCluster = 8;	// sectors written behind together
 
 class OpenFile {
   public:
@@ -85,10 +99,27 @@ class OpenFile {
 					// file (this interface is simpler 
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back 
+    bool Extend(PersistBitMap *freeMap, int newLength);
+					// Make the file longer
     
   private:
-    FileHeader *hdr;			// Header for this file 
+    Inode *inode;			// Cached header for this file,
+    FileHeader *hdr;			//  and the header itself
     int seekPosition;			// Current position within the file
+
+    int nextPosition;			// where the last Read or Write ended;
+					//  one starting there is sequential
+    int window;				// sectors to read ahead next; 0 if
+					//  access is not sequential
+    int aheadStart, aheadEnd;		// the sectors of the file read
+					//  ahead last time
+    int behindSector;			// first sector written in order and
+					//  not yet written behind; -1 if none
+
+    void ReadAhead(int position, int numBytes, bool sequential);
+    void WriteBehind(int position, int numBytes, bool sequential);
+    void Push(int from, int to);	// write sectors "from" up to "to"
+					//  of the file behind
 };
 
 #endif // FILESYS
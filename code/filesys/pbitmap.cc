@@ -7,7 +7,9 @@
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
+#include "debug.h"
 #include "pbitmap.h"
+#include <string.h>
 
 //----------------------------------------------------------------------
 // PersistBitMap::PersistBitMap
@@ -19,6 +21,10 @@
 
 PersistBitMap::PersistBitMap(int numItems):BitMap(numItems) 
 { 
+    written = NULL;
+    numGroups = divRoundUp(numItems, SectorsPerGroup);
+    groupClear = new int[numGroups];
+    Count();
 }
 
 PersistBitMap::PersistBitMap(OpenFile *file, int numItems):BitMap(numItems)
@@ -26,7 +32,12 @@ PersistBitMap::PersistBitMap(OpenFile *file, int numItems):BitMap(numItems)
     // map has already been initialized by the BitMap constructor,
     // but we will just overwrite that with the contents of the
     // map found in the file
+    written = NULL;
+    numGroups = divRoundUp(numItems, SectorsPerGroup);
+    groupClear = new int[numGroups];
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    Written();
+    Count();
 }
 //----------------------------------------------------------------------
 // BitMap::~BitMap
@@ -35,6 +46,8 @@ PersistBitMap::PersistBitMap(OpenFile *file, int numItems):BitMap(numItems)
 
 PersistBitMap::~PersistBitMap()
 { 
+    delete [] written;
+    delete [] groupClear;
 }
 
 
@@ -49,11 +62,14 @@ void
 PersistBitMap::FetchFrom(OpenFile *file) 
 {
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    Written();
+    Count();
 }
 
 //----------------------------------------------------------------------
 // BitMap::WriteBack
-// 	Store the contents of a bitmap to a Nachos file.
+// 	Store the contents of a bitmap to a Nachos file.  Only the
+//	sectors of the file that are out of date are written.
 //
 //	"file" is the place to write the bitmap to
 //----------------------------------------------------------------------
@@ -61,5 +77,263 @@ PersistBitMap::FetchFrom(OpenFile *file)
 void
 PersistBitMap::WriteBack(OpenFile *file)
 {
-   file->WriteAt((char *)map, numWords * sizeof(unsigned), 0);
+    int length = numWords * sizeof(unsigned);
+
+    for (int offset = 0; offset < length; offset += SectorSize) {
+	int n = min(SectorSize, length - offset);
+
+	if (written == NULL || memcmp((char *)map + offset,
+				(char *)written + offset, n) != 0)
+	    file->WriteAt((char *)map + offset, n, offset);
+    }
+    Written();
+}
+
+//----------------------------------------------------------------------
+// PersistBitMap::Written
+// 	Remember that the file holds what is in "map" now.
+//----------------------------------------------------------------------
+
+void
+PersistBitMap::Written()
+{
+    if (written == NULL)
+	written = new unsigned int[numWords];
+    bcopy((char *)map, (char *)written, numWords * sizeof(unsigned));
+}
+
+//----------------------------------------------------------------------
+// PersistBitMap::Count
+// 	Count the clear bits in each group, after "map" has been read in.
+//----------------------------------------------------------------------
+
+void
+PersistBitMap::Count()
+{
+    numClear = 0;
+    for (int g = 0; g < numGroups; g++)
+	groupClear[g] = 0;
+    for (int i = 0; i < numBits; i++) {
+	if (!Test(i)) {
+	    groupClear[i / SectorsPerGroup]++;
+	    numClear++;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// PersistBitMap::Mark, PersistBitMap::Clear
+// 	Set or clear the "nth" bit, and count the change.
+//----------------------------------------------------------------------
+
+void
+PersistBitMap::Mark(int which)
+{
+    if (!Test(which)) {
+	groupClear[which / SectorsPerGroup]--;
+	numClear--;
+    }
+    BitMap::Mark(which);
+}
+
+void
+PersistBitMap::Clear(int which)
+{
+    if (Test(which)) {
+	groupClear[which / SectorsPerGroup]++;
+	numClear++;
+    }
+    BitMap::Clear(which);
+}
+
+//----------------------------------------------------------------------
+// PersistBitMap::FindAndSet, PersistBitMap::NumClear
+// 	As for BitMap, but using the counts.
+//----------------------------------------------------------------------
+
+int
+PersistBitMap::FindAndSet()
+{
+    return FindAndSetNear(0);
+}
+
+int
+PersistBitMap::NumClear() const
+{
+    return numClear;
+}
+
+//----------------------------------------------------------------------
+// PersistBitMap::RunLength
+// 	Return how many clear bits there are in a row from "start", up
+//	to "most".  A group that is entirely clear is stepped over
+//	whole.
+//----------------------------------------------------------------------
+
+int
+PersistBitMap::RunLength(int start, int most)
+{
+    int i = start;
+
+    while (i - start < most && i < numBits) {
+	if (i % SectorsPerGroup == 0
+		&& groupClear[i / SectorsPerGroup] == SectorsPerGroup)
+	    i += SectorsPerGroup;
+	else if (!Test(i))
+	    i++;
+	else
+	    break;
+    }
+    return min(i - start, most);
+}
+
+//----------------------------------------------------------------------
+// PersistBitMap::FindRun
+// 	Find a run of clear bits: the first one at least "want" long,
+//	looking from "near" to the end of the map and then from the
+//	start, or if there is none, the longest.  Return its start, and
+//	set "*length" to how much of it to use.  Groups with no clear
+//	bits are passed over.  There must be at least one clear bit.
+//
+//	"near" -- where the run would best be; a run that "near" is in
+//		the middle of counts from there
+//----------------------------------------------------------------------
+
+int
+PersistBitMap::FindRun(int near, int want, int *length)
+{
+    int first = near / SectorsPerGroup;
+    int bestStart = -1, bestLength = 0;
+
+    ASSERT(numClear > 0 && near >= 0 && near < numBits);
+    for (int k = 0; k <= numGroups; k++) {
+	int g = (first + k) % numGroups;
+	int from = (k == 0) ? near : g * SectorsPerGroup;
+	int to = (k == numGroups) ? near
+			: min((g + 1) * SectorsPerGroup, numBits);
+
+	if (groupClear[g] == 0)
+	    continue;
+	for (int i = from; i < to; i++) {
+	    int n;
+
+	    if (Test(i))
+		continue;
+	    if (i == from && k > 0 && i > 0 && !Test(i - 1)) {
+		i += RunLength(i, numBits);	// carried on from the
+		continue;			// group before
+	    }
+	    n = RunLength(i, want);
+	    if (n == want) {
+		*length = want;
+		return i;
+	    }
+	    if (n > bestLength) {
+		bestStart = i;
+		bestLength = n;
+	    }
+	    i += n;
+	}
+    }
+    ASSERT(bestStart >= 0);
+    *length = bestLength;
+    return bestStart;
+}
+
+//----------------------------------------------------------------------
+// PersistBitMap::FindAndSetNear
+// 	Set and return the first clear bit at or after "near" that
+//	starts a run at least "room" long (or if there is none, that
+//	starts the longest run).  Return -1 if no bits are clear.
+//
+//	"room" -- how much the caller would like to allocate next to
+//		the bit, such as the data of a new file after its header
+//----------------------------------------------------------------------
+
+int
+PersistBitMap::FindAndSetNear(int near, int room)
+{
+    int start, length;
+
+    if (numClear == 0)
+	return -1;
+    start = FindRun(near, room, &length);
+    Mark(start);
+    return start;
+}
+
+//----------------------------------------------------------------------
+// PersistBitMap::FindAndSetApart
+// 	Set and return a clear bit in the middle of the longest run of
+//	clear bits, at the start of a group if it can be.  Return -1 if
+//	no bits are clear.
+//
+//	Each run found this way is split in two, so bits taken one after
+//	another end up spread evenly over the map.
+//----------------------------------------------------------------------
+
+int
+PersistBitMap::FindAndSetApart()
+{
+    int bestStart = -1, bestLength = 0, middle;
+
+    for (int i = 0; i < numBits; i++) {
+	int n;
+
+	if (Test(i))
+	    continue;
+	n = RunLength(i, numBits);
+	if (n > bestLength) {
+	    bestStart = i;
+	    bestLength = n;
+	}
+	i += n;
+    }
+    if (bestStart == -1)
+	return -1;
+    middle = bestStart + bestLength / 2;
+    if (middle - middle % SectorsPerGroup >= bestStart)
+	middle -= middle % SectorsPerGroup;
+    Mark(middle);
+    return middle;
+}
+
+//----------------------------------------------------------------------
+// PersistBitMap::PrintFragmentation
+// 	Print how the clear bits are spread out: how many runs they are
+//	in, how long the runs are, and how many groups are entirely
+//	clear, entirely set, or mixed.  The more runs, and the shorter
+//	the longest one, the more pieces new files will be broken into.
+//----------------------------------------------------------------------
+
+void
+PersistBitMap::PrintFragmentation()
+{
+    int runs = 0, longest = 0, clearGroups = 0, fullGroups = 0;
+
+    for (int i = 0; i < numBits; i++) {
+	int n;
+
+	if (Test(i))
+	    continue;
+	n = RunLength(i, numBits);
+	runs++;
+	longest = max(longest, n);
+	i += n;
+    }
+    for (int g = 0; g < numGroups; g++) {
+	if (groupClear[g] == 0)
+	    fullGroups++;
+	else if (groupClear[g] == min(SectorsPerGroup,
+				numBits - g * SectorsPerGroup))
+	    clearGroups++;
+    }
+    printf("Free space: %d of %d sectors, in %d runs", numClear, numBits,
+									runs);
+    if (runs > 0)
+	printf(" (longest %d, mean %d)", longest, numClear / runs);
+    printf("\n");
+    printf("Groups of %d sectors: %d free, %d full, %d partly used\n",
+		SectorsPerGroup, clearGroups, fullGroups,
+		numGroups - clearGroups - fullGroups);
 }
@@ -11,11 +11,33 @@
 
 #include "copyright.h"
 #include "bitmap.h"
+#include "disk.h"
 #include "openfile.h"
 
+// Bits are grouped a track's worth at a time, for the allocator below:
+// sectors in the same group can be read one after the other without
+// moving the disk head.
+#define SectorsPerGroup		SectorsPerTrack
+
 // The following class defines a persistent bitmap.  It inherits all
 // the behavior of a bitmap (see bitmap.h), adding the ability to
 // be read from and stored to the disk.
+//
+// It remembers what the file holds, so that WriteBack only writes
+// the sectors of the file with bits that have changed.
+//
+// It also serves as the file system's allocator of disk sectors.
+// Rather than the first clear bit on the disk, it hands out the first
+// run of clear bits at or after a "hint" -- such as where a file's
+// header or its last sector is -- so that what is read together is
+// stored together.  It keeps count of the clear bits in each group,
+// so that the search can step over full groups without looking at
+// their bits.
+//
+// Things that will grow, such as a new directory and the files
+// that will go in it, are instead started apart from everything
+// else, so that they have room to grow without being interleaved
+// with each other.
 
 class PersistBitMap : public BitMap {
   public:
@@ -24,6 +46,29 @@ class PersistBitMap : public BitMap {
     ~PersistBitMap(); 			// deallocate bitmap
     void FetchFrom(OpenFile *file);
     void WriteBack(OpenFile *file); 	// write bitmap contents to disk 
+
+    void Mark(int which);		// as for BitMap, keeping count of
+    void Clear(int which);		// the clear bits in each group
+    int FindAndSet();
+    int NumClear() const;
+
+    int FindRun(int near, int want, int *length);
+					// find clear bits at or after "near"
+    int FindAndSetNear(int near, int room = 1);
+					// set a clear bit at or after "near"
+    int FindAndSetApart();		// set a clear bit far from the
+					// others that are set
+    void PrintFragmentation();		// how broken up the clear bits are
+
+  private:
+    int numGroups;
+    int *groupClear;			// clear bits in each group
+    int numClear;			// ... and altogether
+    unsigned int *written;		// the contents of the file, if
+					// known; otherwise NULL
+    void Written();			// the file now matches "map"
+    void Count();			// work out the counts from "map"
+    int RunLength(int start, int most);	// clear bits from "start" on
 };
 
 #endif // PBITMAP_H
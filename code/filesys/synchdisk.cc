@@ -5,19 +5,61 @@
 //	the disk providing a synchronous interface (requests wait until
 //	the request completes).
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	Each request has its own semaphore, to synchronize the interrupt
+//	handler with the thread that made it.  Because the physical disk
+//	can only handle one operation at a time, requests that arrive
+//	while it is busy are queued, and the interrupt handler for one
+//	request starts the next.  The queue is shared with the interrupt
+//	handler, so it is protected by turning interrupts off, not by a
+//	lock.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
+#include "main.h"
 #include "synchdisk.h"
 
 
+//----------------------------------------------------------------------
+// DiskRequest::DiskRequest
+// 	Set up a request to read/write a run of sectors.
+//
+//	"sectorNumber" -- the first disk sector to read/write
+//	"buffers" -- where the data comes from or goes to, per sector
+//	"numSectors" -- how many sectors
+//	"isWrite" -- TRUE for a write
+//----------------------------------------------------------------------
+
+DiskRequest::DiskRequest(int sectorNumber, char **buffers, int numSectors,
+			 bool isWrite)
+{
+    sector = sectorNumber;
+    count = numSectors;
+    data = buffers;
+    writing = isWrite;
+    queuedAt = kernel->stats->totalTicks;
+    done = new Semaphore("disk request", 0);
+}
+
+DiskRequest::~DiskRequest()
+{
+    delete done;
+}
+
+//----------------------------------------------------------------------
+// SectorCompare
+// 	Order pending requests by sector, so that requests on the same
+//	track are next to each other, in arrival order.
+//----------------------------------------------------------------------
+
+static int
+SectorCompare(DiskRequest *x, DiskRequest *y)
+{
+    return x->sector - y->sector;
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
 // 	Initialize the synchronous interface to the physical disk, in turn
@@ -25,12 +67,17 @@
 //
 //	"name" -- UNIX file name to be used as storage for the disk data
 //	   (usually, "DISK")
+//	"type" -- the order in which to serve queued requests
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk(char* name)
+SynchDisk::SynchDisk(char* name, DiskSchedType type)
 {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
+    schedType = type;
+    pending = new SortedList<DiskRequest *>(SectorCompare);
+    active = NULL;
+    headSector = 0;			// where Disk starts the head
+    movingUp = TRUE;
+    numRequests = 0;
     disk = new Disk(name, this);
 }
 
@@ -43,8 +90,7 @@ SynchDisk::SynchDisk(char* name)
 SynchDisk::~SynchDisk()
 {
     delete disk;
-    delete lock;
-    delete semaphore;
+    delete pending;
 }
 
 //----------------------------------------------------------------------
@@ -59,11 +105,11 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
+    DiskRequest req(sectorNumber, &data, 1, FALSE);
+
     DEBUG(dbgPage,"Thread " << kernel->currentThread->getName() << " is reading Disk, sleep and wiat reading disk")
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    Submit(&req);
+    req.done->P();			// wait for interrupt
 }
 
 //----------------------------------------------------------------------
@@ -78,21 +124,223 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
+    DiskRequest req(sectorNumber, &data, 1, TRUE);
+
     DEBUG(dbgPage,"Thread " << kernel->currentThread->getName() << " is writing Disk, sleep and wiat writing disk")
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    Submit(&req);
+    req.done->P();			// wait for interrupt
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors/WriteSectors
+// 	Read/write "numSectors" consecutive sectors, from/to one buffer
+//	of numSectors * SectorSize bytes.
+//
+//	"sectorNumber" -- the first disk sector to read/write
+//	"data" -- the buffer
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int sectorNumber, int numSectors, char* data)
+{
+    int *sectors = new int[numSectors];
+    char **buffers = new char *[numSectors];
+
+    for (int i = 0; i < numSectors; i++) {
+	sectors[i] = sectorNumber + i;
+	buffers[i] = &data[i * SectorSize];
+    }
+    Transfer(sectors, buffers, numSectors, FALSE);
+    delete [] sectors;
+    delete [] buffers;
+}
+
+void
+SynchDisk::WriteSectors(int sectorNumber, int numSectors, char* data)
+{
+    int *sectors = new int[numSectors];
+    char **buffers = new char *[numSectors];
+
+    for (int i = 0; i < numSectors; i++) {
+	sectors[i] = sectorNumber + i;
+	buffers[i] = &data[i * SectorSize];
+    }
+    Transfer(sectors, buffers, numSectors, TRUE);
+    delete [] sectors;
+    delete [] buffers;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadScatter/WriteGather
+// 	Read/write "count" sectors, in any order, each from/to its own
+//	buffer.  Runs of consecutive sectors are best listed in order,
+//	so that each goes to the disk as one request.
+//
+//	"sectors" -- the disk sectors to read/write
+//	"data" -- one buffer of SectorSize bytes for each
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadScatter(int *sectors, char **data, int count)
+{
+    Transfer(sectors, data, count, FALSE);
+}
+
+void
+SynchDisk::WriteGather(int *sectors, char **data, int count)
+{
+    Transfer(sectors, data, count, TRUE);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Transfer
+// 	Break a list of sectors up into runs that are consecutive and
+//	on one track, hand them all to the disk at once (so that the
+//	scheduler can order them), and wait for every one.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Transfer(int *sectors, char **data, int count, bool writing)
+{
+    List<DiskRequest *> runs;
+    int start, end;
+
+    for (start = 0; start < count; start = end) {
+	for (end = start + 1; end < count; end++) {
+	    if (sectors[end] != sectors[end - 1] + 1 ||
+			sectors[end] % SectorsPerTrack == 0)
+		break;
+	}
+	runs.Append(new DiskRequest(sectors[start], &data[start],
+						end - start, writing));
+    }
+
+    ListIterator<DiskRequest *> it(&runs);
+    for (; !it.IsDone(); it.Next())
+	Submit(it.Item());
+    while (!runs.IsEmpty()) {
+	DiskRequest *req = runs.RemoveFront();
+
+	req->done->P();			// wait for interrupt
+	delete req;
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Submit
+// 	Send "req" to the disk if it is idle, otherwise queue it.  The
+//	caller waits on req->done.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Submit(DiskRequest *req)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    ASSERT((req->sector >= 0) && (req->sector + req->count <= NumSectors));
+    req->seq = numRequests++;
+    if (active == NULL) {
+	Start(req);
+    } else {
+	DEBUG(dbgDisk, "Queueing request for sector " << req->sector);
+	pending->Insert(req);
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Start
+// 	Send "req" to the disk, and charge it for the seek.  Called with
+//	interrupts disabled, either by the thread that made the request,
+//	or by the interrupt handler for the one before it.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Start(DiskRequest *req)
+{
+    int tracks = abs(req->sector / SectorsPerTrack -
+				headSector / SectorsPerTrack);
+
+    active = req;
+    if (req->sector != headSector)
+	movingUp = (req->sector > headSector);
+    headSector = req->sector + req->count - 1;
+    kernel->stats->diskSeekTicks += tracks * SeekTime;
+    kernel->stats->diskQueueTicks += kernel->stats->totalTicks - req->queuedAt;
+    if (req->writing)
+	disk->WriteRequest(req->sector, req->data, req->count);
+    else
+	disk->ReadRequest(req->sector, req->data, req->count);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::PickNext
+// 	Remove and return the queued request to serve next.  The queue
+//	is sorted by sector, so SCAN and C-LOOK take the first request
+//	at or past the head, and SSTF looks on either side of it.
+//----------------------------------------------------------------------
+
+DiskRequest *
+SynchDisk::PickNext()
+{
+    ListIterator<DiskRequest *> it(pending);
+    DiskRequest *below = NULL;		// last request before the head
+    DiskRequest *above = NULL;		// first request at or past it
+    DiskRequest *next = NULL;
+    int headTrack = headSector / SectorsPerTrack;
+
+    for (; !it.IsDone(); it.Next()) {
+	DiskRequest *req = it.Item();
+
+	switch (schedType) {
+	  case DiskFCFS:
+	    if (next == NULL || req->seq < next->seq)
+		next = req;
+	    break;
+	  case DiskSSTF:
+	    if (next == NULL || abs(req->sector / SectorsPerTrack - headTrack)
+			< abs(next->sector / SectorsPerTrack - headTrack))
+		next = req;
+	    break;
+	  default:
+	    if (req->sector < headSector)
+		below = req;
+	    else if (above == NULL)
+		above = req;
+	    break;
+	}
+    }
+
+    switch (schedType) {
+      case DiskSCAN:
+	if (movingUp)
+	    next = (above != NULL) ? above : below;
+	else
+	    next = (below != NULL) ? below : above;
+	break;
+      case DiskCLOOK:
+	next = (above != NULL) ? above : pending->Front();
+	break;
+      default:
+	break;
+    }
+    pending->Remove(next);
+    return next;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::CallBack
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Wake up the thread waiting for the disk
+//	request to finish, and start the next one, if any.
 //----------------------------------------------------------------------
 
 void
 SynchDisk::CallBack()
 { 
-    semaphore->V();
+    DiskRequest *finished = active;
+
+    active = NULL;
+    if (!pending->IsEmpty())
+	Start(PickNext());
+    finished->done->V();
 }
@@ -13,6 +13,48 @@
 #include "disk.h"
 #include "synch.h"
 #include "callback.h"
+#include "list.h"
+
+// The order in which queued requests are sent to the disk.
+//
+//   DiskFCFS	in order of arrival
+//   DiskSSTF	shortest seek first: the request nearest the head
+//   DiskSCAN	elevator: keep moving the head the same way while there
+//		are requests ahead of it, then turn around.  (Strictly,
+//		this is LOOK; since the head only ever moves to a
+//		request, running on to the last track would order the
+//		requests the same way and just waste the seek.)
+//   DiskCLOOK	circular LOOK: serve requests on the way up only, then
+//		go back to the lowest one; waits are more even than SCAN
+
+enum DiskSchedType {
+    DiskFCFS,
+    DiskSSTF,
+    DiskSCAN,
+    DiskCLOOK
+};
+
+class Semaphore;
+
+// One read or write waiting for, or using, the disk: a run of "count"
+// consecutive sectors on one track, each with its own buffer.  The
+// thread that made it sleeps on "done" until the disk interrupt for
+// it comes in.
+
+class DiskRequest {
+  public:
+    DiskRequest(int sectorNumber, char **buffers, int numSectors,
+		bool isWrite);
+    ~DiskRequest();
+
+    int sector;				// the first one
+    int count;
+    char **data;
+    bool writing;
+    int seq;				// arrival order, for FCFS
+    long long queuedAt;			// when the request was made
+    Semaphore *done;
+};
 
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
@@ -24,11 +66,15 @@
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
 // returning.
-class Semaphore;
-class Lock;
+//
+// Any number of threads may have requests outstanding.  While the
+// disk is busy, new ones wait in a queue sorted by sector; when it
+// finishes, the interrupt handler picks the next one according to
+// the scheduling policy and starts it.
 class SynchDisk : public CallBackObj {
   public:
-    SynchDisk(char* name);    		// Initialize a synchronous disk,
+    SynchDisk(char* name, DiskSchedType type = DiskFCFS);
+    					// Initialize a synchronous disk,
 					// by initializing the raw Disk.
     ~SynchDisk();			// De-allocate the synch disk data
     
@@ -39,6 +85,19 @@ class SynchDisk : public CallBackObj {
     					// Disk::ReadRequest/WriteRequest and
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, char* data);
+
+    void ReadSectors(int sectorNumber, int numSectors, char* data);
+    void WriteSectors(int sectorNumber, int numSectors, char* data);
+					// Read/write consecutive sectors,
+					// to/from one contiguous buffer
+    void ReadScatter(int *sectors, char **data, int count);
+    void WriteGather(int *sectors, char **data, int count);
+					// Read/write any "count" sectors,
+					// each to/from its own buffer
+					// All of these send each run of
+					// consecutive sectors on a track to
+					// the disk as one request, and
+					// return when every run is done.
     
     void CallBack();			// Called by the disk device interrupt
 					// handler, to signal that the
@@ -46,10 +105,18 @@ class SynchDisk : public CallBackObj {
 
   private:
     Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    DiskSchedType schedType;
+    SortedList<DiskRequest *> *pending;	// waiting for the disk, by sector
+    DiskRequest *active;		// using the disk; NULL if idle
+    int headSector;			// where the last request left the head
+    bool movingUp;			// SCAN direction
+    int numRequests;			// numbers requests in arrival order
+
+    void Transfer(int *sectors, char **data, int count, bool writing);
+					// split into runs, and wait for them
+    void Submit(DiskRequest *req);	// start or queue "req"
+    void Start(DiskRequest *req);	// send "req" to the disk
+    DiskRequest *PickNext();		// remove the next request to serve
 };
 
 #endif // SYNCHDISK_H
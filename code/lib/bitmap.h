@@ -34,15 +34,17 @@ class BitMap {
   public:
     BitMap(int numItems);	// Initialize a bitmap, with "numItems" bits
 				// initially, all bits are cleared.
-    ~BitMap();			// De-allocate bitmap
+    virtual ~BitMap();		// De-allocate bitmap
     
-    void Mark(int which);   	// Set the "nth" bit
-    void Clear(int which);  	// Clear the "nth" bit
+    virtual void Mark(int which);   // Set the "nth" bit
+    virtual void Clear(int which);  // Clear the "nth" bit
     bool Test(int which) const;	// Is the "nth" bit set?
-    int FindAndSet();         // Return the # of a clear bit, and as a side
+    virtual int FindAndSet();   // Return the # of a clear bit, and as a side
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
-    int NumClear() const;	// Return the number of clear bits
+    virtual int NumClear() const;	// Return the number of clear bits
+				// (A subclass may keep track of the
+				// bits as they change.)
 
     void Print() const;		// Print contents of bitmap
     void SelfTest();		// Test whether bitmap is working
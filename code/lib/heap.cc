@@ -0,0 +1,267 @@
+// heap.cc
+//     	Routines to manage a priority queue implemented as a binary heap.
+//	As with lists, heaps are templates so that we can store
+//	anything in them in a type-safe manner.
+//
+// 	The heap is kept in an array; the children of the item at index
+//	i are at 2i+1 and 2i+2.  The array doubles in size when it fills
+//	up, and is never shrunk.
+//
+//     	NOTE: Mutual exclusion must be provided by the caller.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+const int HeapInitialSize = 16;
+
+//----------------------------------------------------------------------
+// Heap<T>::Heap
+//	Initialize a heap, empty to start with.
+//
+//	"comp" is the function used to order the items
+//----------------------------------------------------------------------
+
+template <class T>
+Heap<T>::Heap(int (*comp)(T x, T y))
+{
+    compare = comp;
+    capacity = HeapInitialSize;
+    items = new T[capacity];
+    numItems = 0;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::~Heap
+//	Prepare a heap for deallocation.
+//----------------------------------------------------------------------
+
+template <class T>
+Heap<T>::~Heap()
+{
+    ASSERT(IsEmpty());		// make sure heap is empty
+    delete [] items;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::SiftUp
+//	Move the item at index "i" up towards the root until its parent
+//	is no larger than it.
+//----------------------------------------------------------------------
+
+template <class T>
+void
+Heap<T>::SiftUp(int i)
+{
+    T item = items[i];
+
+    while (i > 0) {
+	int parent = (i - 1) / 2;
+	if (compare(item, items[parent]) >= 0)
+	    break;
+	items[i] = items[parent];
+	i = parent;
+    }
+    items[i] = item;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::SiftDown
+//	Move the item at index "i" down towards the leaves until neither
+//	child is smaller than it.
+//----------------------------------------------------------------------
+
+template <class T>
+void
+Heap<T>::SiftDown(int i)
+{
+    T item = items[i];
+
+    for (;;) {
+	int child = 2 * i + 1;
+	if (child >= numItems)
+	    break;
+	if ((child + 1 < numItems) && (compare(items[child + 1], items[child]) < 0))
+	    child++;			// pick the smaller child
+	if (compare(items[child], item) >= 0)
+	    break;
+	items[i] = items[child];
+	i = child;
+    }
+    items[i] = item;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Insert
+//      Put an "item" into the heap, growing the array if it is full.
+//
+//	"item" is the thing to put in the heap.
+//----------------------------------------------------------------------
+
+template <class T>
+void
+Heap<T>::Insert(T item)
+{
+    if (numItems == capacity) {		// out of room, double the array
+	T *bigger = new T[capacity * 2];
+	for (int i = 0; i < numItems; i++)
+	    bigger[i] = items[i];
+	delete [] items;
+	items = bigger;
+	capacity *= 2;
+    }
+    items[numItems] = item;
+    SiftUp(numItems);
+    numItems++;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::RemoveFront
+//      Remove the smallest item from the heap.  The heap must not be
+//	empty.
+//
+// Returns:
+//	The removed item.
+//----------------------------------------------------------------------
+
+template <class T>
+T
+Heap<T>::RemoveFront()
+{
+    T thing;
+
+    ASSERT(!IsEmpty());
+    thing = items[0];
+    numItems--;
+    if (numItems > 0) {
+	items[0] = items[numItems];
+	SiftDown(0);
+    }
+    return thing;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::IndexOf
+//      Return the position of "item" in the heap array, or -1 if it
+//	isn't there.
+//----------------------------------------------------------------------
+
+template <class T>
+int
+Heap<T>::IndexOf(T item) const
+{
+    for (int i = 0; i < numItems; i++) {
+	if (item == items[i]) {
+	    return i;
+	}
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Remove
+//      Remove a specific item from the heap.  Must be in the heap!
+//	Finding the item is a linear search, but putting the heap back
+//	in order afterwards is O(log n).
+//----------------------------------------------------------------------
+
+template <class T>
+void
+Heap<T>::Remove(T item)
+{
+    int i = IndexOf(item);
+
+    ASSERT(i != -1);		// should always find item!
+    numItems--;
+    if (i < numItems) {
+	items[i] = items[numItems];
+	SiftUp(i);
+	SiftDown(i);
+    }
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::IsInHeap
+//      Return TRUE if the item is in the heap.
+//----------------------------------------------------------------------
+
+template <class T>
+bool
+Heap<T>::IsInHeap(T item) const
+{
+    return (IndexOf(item) != -1);
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::Apply
+//      Apply function to every item in the heap, in array order
+//	(which is *not* sorted order).
+//
+//	"func" -- the function to apply
+//----------------------------------------------------------------------
+
+template <class T>
+void
+Heap<T>::Apply(void (*func)(T)) const
+{
+    for (int i = 0; i < numItems; i++) {
+        (*func)(items[i]);
+    }
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::SanityCheck
+//      Test whether this is still a legal heap.
+//
+//	Test: is every item no smaller than its parent?
+//----------------------------------------------------------------------
+
+template <class T>
+void
+Heap<T>::SanityCheck() const
+{
+    ASSERT((numItems >= 0) && (numItems <= capacity));
+    for (int i = 1; i < numItems; i++) {
+	ASSERT(compare(items[(i - 1) / 2], items[i]) <= 0);
+    }
+}
+
+//----------------------------------------------------------------------
+// Heap<T>::SelfTest
+//      Test whether this module is working.
+//----------------------------------------------------------------------
+
+template <class T>
+void
+Heap<T>::SelfTest(T *p, int numEntries)
+{
+    int i;
+    T *q = new T[numEntries];
+
+    ASSERT(IsEmpty());
+    SanityCheck();
+    for (i = 0; i < numEntries; i++) {
+	Insert(p[i]);
+	ASSERT(IsInHeap(p[i]));
+	SanityCheck();
+    }
+
+    // take one out of the middle and put it back
+    Remove(p[numEntries / 2]);
+    ASSERT(!IsInHeap(p[numEntries / 2]));
+    SanityCheck();
+    Insert(p[numEntries / 2]);
+
+    // should be able to get out everything we put in, smallest first
+    for (i = 0; i < numEntries; i++) {
+	q[i] = RemoveFront();
+	SanityCheck();
+    }
+    ASSERT(IsEmpty());
+    for (i = 0; i < (numEntries - 1); i++) {
+	ASSERT(compare(q[i], q[i + 1]) <= 0);
+    }
+    delete [] q;
+}
@@ -0,0 +1,81 @@
+// heap.h
+//	Data structures to manage a priority queue, implemented as a
+//	binary heap stored in an array.
+//
+//	A heap has the same "Compare" interface as a SortedList, and
+//	RemoveFront always returns the smallest element; but Insert and
+//	RemoveFront each take O(log n) time instead of O(n).  The array
+//	grows by doubling, so once the heap has reached its working size
+//	no further memory is allocated.
+//
+//	Unlike a SortedList, a heap does not keep elements that compare
+//	equal in insertion order.  If the order among equal elements
+//	matters, the compare function has to break the tie itself (for
+//	instance, by comparing a sequence number stored in the item).
+//
+//	Allocation and deallocation of the items in the heap are to be
+//	done by the caller.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "copyright.h"
+#include "debug.h"
+
+// The following class defines a "heap" -- a partially ordered array,
+// such that the item at index i is never larger than the items at
+// 2i+1 and 2i+2.  The smallest item is therefore always at index 0.
+//
+// All types to be inserted into a heap must have a "Compare"
+// function defined:
+//	   int Compare(T x, T y)
+//		returns -1 if x < y
+//		returns 0 if x == y
+//		returns 1 if x > y
+
+template <class T>
+class Heap {
+  public:
+    Heap(int (*comp)(T x, T y));	// initialize the heap
+    ~Heap();				// de-allocate the heap
+
+    void Insert(T item);		// put an item in the heap
+    T Front() { ASSERT(!IsEmpty()); return items[0]; }
+    					// return the smallest item
+					// without removing it
+    T RemoveFront();			// remove the smallest item
+    void Remove(T item);		// remove a specific item;
+					// must be in the heap!
+
+    bool IsInHeap(T item) const;	// is the item in the heap?
+    unsigned int NumInHeap() { return numItems; }
+    					// how many items in the heap?
+    bool IsEmpty() { return (numItems == 0); }
+    					// is the heap empty?
+
+    void Apply(void (*f)(T)) const;	// apply function to all elements
+    					// in the heap, in no particular order
+
+    void SanityCheck() const;		// has this heap been corrupted?
+    void SelfTest(T *p, int numEntries);
+    					// verify module is working
+
+  private:
+    T *items;				// the heap array
+    int numItems;			// number of items in use
+    int capacity;			// size of the heap array
+    int (*compare)(T x, T y);		// function for ordering items
+
+    void SiftUp(int i);			// restore heap order above i
+    void SiftDown(int i);		// restore heap order below i
+    int IndexOf(T item) const;		// position of item, or -1
+};
+
+#include "heap.cc"		// templates are really like macros
+				// so needs to be included in every
+				// file that uses the template
+#endif // HEAP_H
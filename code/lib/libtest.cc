@@ -11,6 +11,7 @@
 #include "bitmap.h"
 #include "list.h"
 #include "hash.h"
+#include "heap.h"
 #include "sysdep.h"
 
 //----------------------------------------------------------------------
@@ -60,7 +61,7 @@ static char *hashTestVector[] = { "0", "1", "2", "3", "4", "5", "6",
 
 //----------------------------------------------------------------------
 // LibSelfTest
-//	Run self tests on bitmaps, lists, sorted lists, and 
+//	Run self tests on bitmaps, lists, sorted lists, heaps, and
 //	hash tables.
 //----------------------------------------------------------------------
 
@@ -69,6 +70,7 @@ LibSelfTest () {
     BitMap *map = new BitMap(200);
     List<int> *list = new List<int>;
     SortedList<int> *sortList = new SortedList<int>(IntCompare);
+    Heap<int> *heap = new Heap<int>(IntCompare);
     HashTable<int, char *> *hashTable = 
 	new HashTable<int, char *>(HashKey, HashInt);
 	
@@ -76,10 +78,12 @@ LibSelfTest () {
     map->SelfTest();
     list->SelfTest(listTestVector, sizeof(listTestVector)/sizeof(int));
     sortList->SelfTest(listTestVector, sizeof(listTestVector)/sizeof(int));
+    heap->SelfTest(listTestVector, sizeof(listTestVector)/sizeof(int));
     hashTable->SelfTest(hashTestVector, sizeof(hashTestVector)/sizeof(char *));
 
     delete map;
     delete list;
     delete sortList;
+    delete heap;
     delete hashTable;
 }
@@ -44,7 +44,7 @@ extern "C" {
 #include <signal.h>
 #include <sys/types.h>
 
-#ifndef NO_MPROT 
+#if !defined(NO_MPROT) || defined(LINUX)
 #include <sys/mman.h>
 #endif
 
@@ -156,6 +156,28 @@ RandomNumber()
     return rand();
 }
 
+//----------------------------------------------------------------------
+// HostNanoseconds
+// 	Return the host's time in nanoseconds.  Uses the monotonic clock
+//	where there is one, so that the result never goes backwards.
+//----------------------------------------------------------------------
+
+long long
+HostNanoseconds()
+{
+#ifdef LINUX
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (long long) tv.tv_sec * 1000000000LL + tv.tv_usec * 1000LL;
+#endif
+}
+
 //----------------------------------------------------------------------
 // AllocBoundedArray
 // 	Return an array, with the two pages just before 
@@ -205,6 +227,89 @@ DeallocBoundedArray(char *ptr, int size)
 #endif
 }
 
+//----------------------------------------------------------------------
+// AllocPooledArray, FreePooledArray
+// 	Like AllocBoundedArray and DeallocBoundedArray, but arrays that
+//	are freed go on a pool, guard pages and all, and are handed out
+//	again by the next request for the same size.  Forking a thread
+//	then costs no host system calls once the pool holds as many
+//	stacks as there have ever been threads at once.
+//
+//	On Linux, each array is mmap'd with an inaccessible page on
+//	either side, which costs one mmap and two mprotect calls the
+//	first time only; elsewhere we fall back on AllocBoundedArray.
+//
+//	"size" -- amount of useful space needed (in bytes)
+//----------------------------------------------------------------------
+
+const int MaxPooledArrays = 64;	// beyond this, freed arrays are released
+
+struct PooledArray {		// overlaid on the start of a free array
+    PooledArray *next;
+    int size;
+};
+
+static PooledArray *arrayPool = NULL;
+static int numPooledArrays = 0;
+
+#ifdef LINUX
+static int
+PooledArraySpan(int size)	// bytes mapped for an array of "size"
+{
+    int pgSize = getpagesize();
+
+    return pgSize * 2 + ((size + pgSize - 1) / pgSize) * pgSize;
+}
+#endif
+
+char *
+AllocPooledArray(int size)
+{
+    PooledArray **pp;
+
+    for (pp = &arrayPool; *pp != NULL; pp = &(*pp)->next) {
+	if ((*pp)->size == size) {
+	    PooledArray *found = *pp;
+	    *pp = found->next;
+	    numPooledArrays--;
+	    return (char *) found;
+	}
+    }
+#ifdef LINUX
+    int pgSize = getpagesize();
+    int span = PooledArraySpan(size);
+    char *ptr = (char *) mmap(NULL, span, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    ASSERT(ptr != (char *) MAP_FAILED);
+    mprotect(ptr, pgSize, PROT_NONE);
+    mprotect(ptr + span - pgSize, pgSize, PROT_NONE);
+    return ptr + pgSize;
+#else
+    return AllocBoundedArray(size);
+#endif
+}
+
+void
+FreePooledArray(char *ptr, int size)
+{
+    ASSERT(size >= (int) sizeof(PooledArray));
+    if (numPooledArrays < MaxPooledArrays) {
+	PooledArray *array = (PooledArray *) ptr;
+
+	array->size = size;
+	array->next = arrayPool;
+	arrayPool = array;
+	numPooledArrays++;
+	return;
+    }
+#ifdef LINUX
+    munmap(ptr - getpagesize(), PooledArraySpan(size));
+#else
+    DeallocBoundedArray(ptr, size);
+#endif
+}
+
 //----------------------------------------------------------------------
 // PollFile
 // 	Check open file or open socket to see if there are any 
@@ -30,11 +30,21 @@ extern void CallOnUserAbort(void (*cleanup)(int));
 extern void RandomInit(unsigned seed);
 extern unsigned int RandomNumber();
 
+// Host time in nanoseconds, from an arbitrary starting point; only
+// differences between two calls are meaningful.  Used for benchmarks.
+extern long long HostNanoseconds();
+
 // Allocate, de-allocate an array, such that de-referencing
 // just beyond either end of the array will cause an error
 extern char *AllocBoundedArray(int size);
 extern void DeallocBoundedArray(char *p, int size);
 
+// The same, but de-allocated arrays are kept (still bounded) and
+// handed out again, so that steady-state allocation makes no host
+// system calls.  Used for thread stacks.
+extern char *AllocPooledArray(int size);
+extern void FreePooledArray(char *p, int size);
+
 // Check file to see if there are any characters to be read.
 // If no characters in the file, return without waiting.
 extern bool PollFile(int fd);
@@ -112,43 +112,84 @@ PrintSector (bool writing, int sector, char *data)
 void
 Disk::ReadRequest(int sectorNumber, char* data)
 {
-    int ticks = ComputeLatency(sectorNumber, FALSE);
+    ReadRequest(sectorNumber, &data, 1);
+}
+
+void
+Disk::WriteRequest(int sectorNumber, char* data)
+{
+    WriteRequest(sectorNumber, &data, 1);
+}
+
+//----------------------------------------------------------------------
+// Disk::ReadRequest/WriteRequest
+// 	Simulate a request to read/write a run of consecutive sectors,
+//	all on the same track.  The head seeks once, and then the
+//	sectors pass under it one after the other, so the whole run
+//	takes one interrupt, and only one rotation time per sector
+//	after the first.
+//
+//	"sectorNumber" -- the first disk sector to read/write
+//	"data" -- one buffer per sector: the bytes to be written, or
+//		where to put the incoming bytes
+//	"count" -- how many sectors
+//----------------------------------------------------------------------
+
+void
+Disk::ReadRequest(int sectorNumber, char** data, int count)
+{
+    int ticks = ComputeLatency(sectorNumber, count, FALSE);
 
     ASSERT(!active);				// only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
-    
-    DEBUG(dbgDisk, "Reading from sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
-    if (debug->IsEnabled('d'))
-	PrintSector(FALSE, sectorNumber, data);
-    
+    Transfer(sectorNumber, data, count, FALSE);
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber + count - 1);
     kernel->stats->numDiskReads++;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
 
 void
-Disk::WriteRequest(int sectorNumber, char* data)
+Disk::WriteRequest(int sectorNumber, char** data, int count)
 {
-    int ticks = ComputeLatency(sectorNumber, TRUE);
+    int ticks = ComputeLatency(sectorNumber, count, TRUE);
 
     ASSERT(!active);
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
-    
-    DEBUG(dbgDisk, "Writing to sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
-    if (debug->IsEnabled('d'))
-	PrintSector(TRUE, sectorNumber, data);
-    
+    Transfer(sectorNumber, data, count, TRUE);
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber + count - 1);
     kernel->stats->numDiskWrites++;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
 
+//----------------------------------------------------------------------
+// Disk::Transfer
+// 	Do the reading/writing for a request, on the UNIX file.
+//----------------------------------------------------------------------
+
+void
+Disk::Transfer(int sectorNumber, char** data, int count, bool writing)
+{
+    ASSERT(count >= 1);
+    ASSERT((sectorNumber >= 0) && (sectorNumber + count <= NumSectors));
+    ASSERT(sectorNumber / SectorsPerTrack ==
+		(sectorNumber + count - 1) / SectorsPerTrack);
+
+    if (writing) {
+	DEBUG(dbgDisk, "Writing to sector " << sectorNumber << ", " << count << " sectors");
+    } else {
+	DEBUG(dbgDisk, "Reading from sector " << sectorNumber << ", " << count << " sectors");
+    }
+    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
+    for (int i = 0; i < count; i++) {
+	if (writing)
+	    WriteFile(fileno, data[i], SectorSize);
+	else
+	    Read(fileno, data[i], SectorSize);
+	if (debug->IsEnabled('d'))
+	    PrintSector(writing, sectorNumber + i, data[i]);
+    }
+}
+
 //----------------------------------------------------------------------
 // Disk::CallBack()
 // 	Called by the machine simulation when the disk interrupt occurs.
@@ -179,7 +220,7 @@ Disk::TimeToSeek(int newSector, int *rotation)
     int oldTrack = lastSector / SectorsPerTrack;
     int seek = abs(newTrack - oldTrack) * SeekTime;
 				// how long will seek take?
-    int over = (kernel->stats->totalTicks + seek) % RotationTime; 
+    int over = (int) ((kernel->stats->totalTicks + seek) % RotationTime);
 				// will we be in the middle of a sector when
 				// we finish the seek?
 
@@ -230,7 +271,7 @@ Disk::ComputeLatency(int newSector, bool writing)
 {
     int rotation;
     int seek = TimeToSeek(newSector, &rotation);
-    int timeAfter = kernel->stats->totalTicks + seek + rotation;
+    long long timeAfter = kernel->stats->totalTicks + seek + rotation;
 
 #ifndef NOTRACKBUF	// turn this on if you don't want the track buffer stuff
     // check if track buffer applies
@@ -248,6 +289,19 @@ Disk::ComputeLatency(int newSector, bool writing)
     return(seek + rotation + RotationTime);
 }
 
+//----------------------------------------------------------------------
+// Disk::ComputeLatency()
+// 	Return how long it will take to read/write "count" consecutive
+//	sectors on one track: the latency of the first, then one
+//	rotation time for each of the rest.
+//----------------------------------------------------------------------
+
+int
+Disk::ComputeLatency(int newSector, int count, bool writing)
+{
+    return ComputeLatency(newSector, writing) + (count - 1) * RotationTime;
+}
+
 //----------------------------------------------------------------------
 // Disk::UpdateLast
 //   	Keep track of the most recently requested sector.  So we can know
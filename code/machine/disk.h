@@ -49,7 +49,7 @@
 
 const int SectorSize = 128;		// number of bytes per disk sector
 const int SectorsPerTrack  = 32;	// number of sectors per disk track 
-const int NumTracks = 32;		// number of tracks per disk
+const int NumTracks = 512;		// number of tracks per disk
 const int NumSectors = (SectorsPerTrack * NumTracks);
 					// total # of sectors per disk
 
@@ -66,6 +66,12 @@ class Disk : public CallBackObj {
     					// the disk and return immediately.
     					// Only one request allowed at a time!
     void WriteRequest(int sectorNumber, char* data);
+    void ReadRequest(int sectorNumber, char** data, int count);
+    void WriteRequest(int sectorNumber, char** data, int count);
+					// Read/write "count" consecutive
+					// sectors on one track, starting at
+					// sectorNumber, each to/from its own
+					// buffer, as a single request.
 
     void CallBack();			// Invoked when disk request 
 					// finishes. In turn calls, callWhenDone.
@@ -74,18 +80,24 @@ class Disk : public CallBackObj {
     					// Return how long a request to 
 					// newSector will take: 
 					// (seek + rotational delay + transfer)
+    int ComputeLatency(int newSector, int count, bool writing);
+					// ... and the count - 1 sectors
+					// after it, which follow with no
+					// further delay
 
   private:
     int fileno;				// UNIX file number for simulated disk 
     CallBackObj *callWhenDone;		// Invoke when any disk request finishes
     bool active;     			// Is a disk operation in progress?
     int lastSector;			// The previous disk request 
-    int bufferInit;			// When the track buffer started 
+    long long bufferInit;		// When the track buffer started 
 					// being loaded
 
     int TimeToSeek(int newSector, int *rotate); // time to get to the new track
     int ModuloDiff(int to, int from);        // # sectors between to and from
     void UpdateLast(int newSector);
+    void Transfer(int sectorNumber, char** data, int count, bool writing);
+					// do the UNIX I/O for a request
 };
 
 #endif // DISK_H
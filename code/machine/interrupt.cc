@@ -42,16 +42,32 @@ static char *intTypeNames[] = { "timer", "disk", "console write",
 //----------------------------------------------------------------------
 
 PendingInterrupt::PendingInterrupt(CallBackObj *callOnInt, 
-					int time, IntType kind)
+					long long time, IntType kind)
+{
+    Init(callOnInt, time, kind);
+}
+
+//----------------------------------------------------------------------
+// PendingInterrupt::Init
+// 	Fill in the fields of an interrupt, either newly allocated or
+//	taken off the free pool.  The caller sets "seq".
+//----------------------------------------------------------------------
+
+void
+PendingInterrupt::Init(CallBackObj *callOnInt, long long time, IntType kind)
 {
     callOnInterrupt = callOnInt;
     when = time;
     type = kind;
+    seq = 0;
+    next = NULL;
 }
 
 //----------------------------------------------------------------------
 // PendingCompare
 //	Compare to interrupts based on which should occur first.
+//	Interrupts due at the same time fire in the order they were
+//	scheduled, as they did when pending was a sorted list.
 //----------------------------------------------------------------------
 
 static int
@@ -59,6 +75,8 @@ PendingCompare (PendingInterrupt *x, PendingInterrupt *y)
 {
     if (x->when < y->when) { return -1; }
     else if (x->when > y->when) { return 1; }
+    else if (x->seq < y->seq) { return -1; }
+    else if (x->seq > y->seq) { return 1; }
     else { return 0; }
 }
 
@@ -72,7 +90,9 @@ PendingCompare (PendingInterrupt *x, PendingInterrupt *y)
 Interrupt::Interrupt()
 {
     level = IntOff;
-    pending = new SortedList<PendingInterrupt *>(PendingCompare);
+    pending = new Heap<PendingInterrupt *>(PendingCompare);
+    freePool = NULL;
+    nextSeq = 0;
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -89,6 +109,11 @@ Interrupt::~Interrupt()
 	delete pending->RemoveFront();
     }
     delete pending;
+    while (freePool != NULL) {
+	PendingInterrupt *p = freePool;
+	freePool = p->next;
+	delete p;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -235,6 +260,10 @@ Interrupt::Halt()
 {
     cout << "Machine halting!\n\n";
     kernel->stats->Print();
+    if (kernel->printMetrics)
+	kernel->scheduler->PrintMetrics();
+    if (kernel->synchProfiler != NULL)
+	kernel->synchProfiler->Print();
     delete kernel;	// Never returns.
 }
 
@@ -243,7 +272,10 @@ Interrupt::Halt()
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: put it on a heap ordered by "when".  The
+//	PendingInterrupt is taken from the free pool if one is there,
+//	so in steady state (the timer re-arming itself every tick)
+//	nothing is allocated.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -252,17 +284,48 @@ Interrupt::Halt()
 //	"fromNow" is how far in the future (in simulated time) the 
 //		 interrupt is to occur
 //	"type" is the hardware device that generated the interrupt
+//
+// Returns:
+//	The scheduled interrupt, which stays valid (for Cancel) only
+//	until it fires.
 //----------------------------------------------------------------------
-void
+PendingInterrupt *
 Interrupt::Schedule(CallBackObj *toCall, int fromNow, IntType type)
 {
-    int when = kernel->stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(toCall, when, type);
+    long long when = kernel->stats->totalTicks + fromNow;
+    PendingInterrupt *toOccur;
+
+    if (freePool != NULL) {
+	toOccur = freePool;
+	freePool = toOccur->next;
+	toOccur->Init(toCall, when, type);
+    } else {
+	toOccur = new PendingInterrupt(toCall, when, type);
+    }
+    toOccur->seq = nextSeq++;
 
     DEBUG(dbgInt, "Scheduling interrupt handler the " << intTypeNames[type] << " at time = " << when);
     ASSERT(fromNow > 0);
 
     pending->Insert(toOccur);
+    return toOccur;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Cancel
+// 	Remove an interrupt that was scheduled but has not yet fired,
+//	as when a device reprograms itself for a different time.
+//
+//	"toCancel" is the interrupt returned by Schedule
+//----------------------------------------------------------------------
+void
+Interrupt::Cancel(PendingInterrupt *toCancel)
+{
+    DEBUG(dbgInt, "Cancelling interrupt handler the " << intTypeNames[toCancel->type] << " at time = " << toCancel->when);
+
+    pending->Remove(toCancel);
+    toCancel->next = freePool;
+    freePool = toCancel;
 }
 
 //----------------------------------------------------------------------
@@ -313,7 +376,8 @@ Interrupt::CheckIfDue(bool advanceClock)
     do {
         next = pending->RemoveFront();    // pull interrupt off list
         next->callOnInterrupt->CallBack();// call the interrupt handler
-	delete next;
+	next->next = freePool;		  // keep it for the next Schedule
+	freePool = next;
     } while (!pending->IsEmpty() 
     		&& (pending->Front()->when <= stats->totalTicks));
     inHandler = FALSE;
@@ -37,6 +37,7 @@
 
 #include "copyright.h"
 #include "list.h"
+#include "heap.h"
 #include "callback.h"
 
 // Interrupts can be disabled (IntOff) or enabled (IntOn)
@@ -59,15 +60,20 @@ enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt,
 
 class PendingInterrupt {
   public:
-    PendingInterrupt(CallBackObj *callOnInt, int time, IntType kind);
+    PendingInterrupt(CallBackObj *callOnInt, long long time, IntType kind);
 				// initialize an interrupt that will
 				// occur in the future
+    void Init(CallBackObj *callOnInt, long long time, IntType kind);
+				// re-initialize a recycled interrupt
 
     CallBackObj *callOnInterrupt;// The object (in the hardware device
 				// emulator) to call when the interrupt occurs
     
-    int when;			// When the interrupt is supposed to fire
+    long long when;		// When the interrupt is supposed to fire
     IntType type;		// for debugging
+    unsigned int seq;		// order in which it was scheduled; breaks
+				// ties between interrupts due at the same time
+    PendingInterrupt *next;	// link on the free pool, when not pending
 };
 
 // The following class defines the data structures for the simulation
@@ -114,18 +120,24 @@ class Interrupt {
     // but they need to be public since they are called by the
     // hardware device simulators.
 
-    void Schedule(CallBackObj *callTo, int when, IntType type);
+    PendingInterrupt *Schedule(CallBackObj *callTo, int when, IntType type);
     				// Schedule an interrupt to occur
 				// at time "when".  This is called
     				// by the hardware device simulators.
+    void Cancel(PendingInterrupt *toCancel);
+    				// Take back an interrupt returned by
+				// Schedule that has not fired yet.
     
     void OneTick();       	// Advance simulated time
 
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    SortedList<PendingInterrupt *> *pending;		
-    				// the list of interrupts scheduled
-				// to occur in the future
+    Heap<PendingInterrupt *> *pending;		
+    				// the interrupts scheduled to occur
+				// in the future, soonest first
+    PendingInterrupt *freePool;	// interrupts that have fired, kept
+				// for reuse by Schedule
+    unsigned int nextSeq;	// sequence number for the next Schedule
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
@@ -20,8 +20,12 @@ Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    diskSeekTicks = diskQueueTicks = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numCacheHits = numCacheMisses = 0;
+    numBursts = 0;
+    burstTicks = burstError = burstAbsError = 0.0;
 }
 
 //----------------------------------------------------------------------
@@ -37,9 +41,28 @@ Statistics::Print()
 		cout << ", system " << systemTicks << ", user " << userTicks <<"\n";
     cout << "Disk I/O: reads " << numDiskReads;
 		cout << ", writes " << numDiskWrites << "\n";
+    if (numDiskReads + numDiskWrites > 0) {
+	int requests = numDiskReads + numDiskWrites;
+
+	cout << "Disk requests: mean seek " << (double) diskSeekTicks / requests;
+	cout << ", mean queue wait " << (double) diskQueueTicks / requests;
+	cout << " ticks\n";
+    }
 		cout << "Console I/O: reads " << numConsoleCharsRead;
     cout << ", writes " << numConsoleCharsWritten << "\n";
     cout << "Paging: faults " << numPageFaults << "\n";
     cout << "Network I/O: packets received " << numPacketsRecvd;
 		cout << ", sent " << numPacketsSent << "\n";
+    if (numCacheHits + numCacheMisses > 0) {
+	cout << "Buffer cache: hits " << numCacheHits;
+	cout << ", misses " << numCacheMisses;
+	cout << ", hit ratio " << (double) numCacheHits /
+			(numCacheHits + numCacheMisses) << "\n";
+    }
+    if (numBursts > 0) {
+	cout << "CPU bursts: predicted " << numBursts;
+	cout << ", mean length " << burstTicks / numBursts;
+	cout << ", mean error " << burstError / numBursts;
+	cout << ", mean abs error " << burstAbsError / numBursts << "\n";
+    }
 }
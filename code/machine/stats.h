@@ -21,21 +21,31 @@
 
 class Statistics {
   public:
-    int totalTicks;      	// Total time running Nachos
-    int idleTicks;       	// Time spent idle (no threads to run)
-    int systemTicks;	 	// Time spent executing system code
-    int userTicks;       	// Time spent executing user code
+    long long totalTicks;	// Total time running Nachos
+    long long idleTicks;	// Time spent idle (no threads to run)
+    long long systemTicks;	// Time spent executing system code
+    long long userTicks;	// Time spent executing user code
 				// (this is also equal to # of
 				// user instructions executed)
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    long long diskSeekTicks;	// time spent moving the disk head
+    long long diskQueueTicks;	// time disk requests spent queued
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
 
+    int numCacheHits;		// sectors found in the buffer cache
+    int numCacheMisses;		// ... and not found
+
+    int numBursts;		// CPU bursts predicted (with -predict)
+    double burstTicks;		// total length of those bursts
+    double burstError;		// sum of (predicted - actual)
+    double burstAbsError;	// sum of |predicted - actual|
+
     Statistics(); 		// initialize everything to zero
 
     void Print();		// print collected statistics
@@ -146,6 +146,14 @@ Sleep:
     j	    $31
     .end	Sleep
 
+	.globl  SetTickets
+	.ent    SetTickets
+SetTickets:
+	addiu   $2,$0,SC_SetTickets
+	syscall
+	j	$31
+	.end	SetTickets
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
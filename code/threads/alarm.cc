@@ -18,11 +18,26 @@
 //
 //      "doRandom" -- if true, arrange for the hardware interrupts to 
 //		occur at random, instead of fixed, intervals.
+//	"ticklessIdle" -- if true, don't take a timer interrupt every
+//		time slice while there is nothing to run; jump straight
+//		to the next sleeper's wake-up time instead.  Ignored
+//		with random time slices, which have no fixed slice length.
+//		The timer device cannot skip interrupts, so in this mode
+//		we don't start one, and schedule our own instead.
 //----------------------------------------------------------------------
 
-Alarm::Alarm(bool doRandom)
+Alarm::Alarm(bool doRandom, bool ticklessIdle)
 {
-    timer = new Timer(doRandom, this);
+    tickless = ticklessIdle && !doRandom;
+    stretch = 1;
+    slices = 1;
+    armed = NULL;
+    if (tickless) {
+	timer = NULL;
+	Arm();
+    } else {
+	timer = new Timer(doRandom, this);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -44,42 +59,116 @@ Alarm::Alarm(bool doRandom)
 //	Also, to keep from looping forever, we check if there's
 //	nothing on the ready list, and there are no other pending
 //	interrupts.  In this case, we can safely halt.
+//
+//	Otherwise, whether the interrupted thread is preempted is up to
+//	the scheduling policy (see SchedPolicy::ShouldPreempt).
+//
+//	In tickless mode, when the machine is idle the next timer
+//	interrupt is put off until the first sleeping thread is due
+//	(or, with no sleepers, until LeaveIdle), so idle time passes
+//	in one jump instead of one time slice at a time.  The same goes
+//	while the current thread is the only one that can run: no time
+//	slice can end until another thread is ready (see Rearm).
+//
+//	"Idle" is the machine's status when the interrupt came, but a
+//	device interrupt due at the same tick may already have readied
+//	a thread.  The timer is then left running for it.
+//
+//	In tickless mode the interrupt is our own (see Arm), and may
+//	stand for several time slices; the next one is scheduled last,
+//	once we know how far off it should be.
 //----------------------------------------------------------------------
 
 void Alarm::CallBack() {// 週期性的打斷CPU
     Interrupt *interrupt = kernel->interrupt;
     Scheduler * scheduler = kernel->scheduler;
     MachineStatus status = interrupt->getStatus();
-    bool woken = scheduler->anyThreadWoken(); // 自定義計數器++；檢查是否有thread已經休眠結束，可以放回Ready Queue
+
+    if (tickless) {
+	armed = NULL;
+	slices = stretch;
+	stretch = 1;
+    }
+    bool woken = scheduler->anyThreadWoken(slices); // 自定義計數器++；檢查是否有thread已經休眠結束，可以放回Ready Queue
+    bool idle = (status == IdleMode);
+
+    scheduler->Tick(slices, idle);
     //如果沒有程式需要計數了，就把時脈中斷遮蔽掉
-    kernel->currentThread->setPriority(kernel->currentThread->getPriority() - 1); //為何要-1
-    if (status == IdleMode && !woken && scheduler->sleepingListEmpty()) {// is it time to quit?
-        if (!interrupt->AnyFutureInterrupts()) {// 有任何在排隊的interrupts嗎？
+    if (idle && !woken && scheduler->sleepingListEmpty()) {// is it time to quit?
+        if (!scheduler->readyListEmpty()) {
+            // not idle after all: a device interrupt due at this same
+            // tick has readied a thread, which needs the timer
+        } else if (tickless) {
+            // nothing to do until a device wakes someone up.  Unlike
+            // Disable, this can be undone (see LeaveIdle).
+            stretch = 0;
+        } else if (!interrupt->AnyFutureInterrupts()) {// 有任何在排隊的interrupts嗎？
             timer->Disable();   // turn off the timer
         }
-    } else {                    // there's someone to preempt
-	    if(kernel->scheduler->getSchedulerType() == RR || kernel->scheduler->getSchedulerType() == Priority) {
-            	interrupt->YieldOnReturn();// 做context switch(換下一組code上來)
-	    } else if (kernel->scheduler->getSchedulerType() == SRTF){
-		//關中斷，不讓其他thread能夠強制進入(preempt)，剔除本thread
-    		IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
-		
-		// 取得readyList裡面最短的thread; 如果readyList沒東西了,離開這個函數
-		Thread *nextShortestThread = kernel->scheduler->FindNextToRun();
-		if (nextShortestThread == NULL){ return; }
-		
-		// 比較應不應該切換thread,並將nextShortestThread放回去
-		//(因為是SRTF才會進到這裡,所以可以保證這個thread回到原位)
-		bool shouldYield = kernel->currentThread->getBurstTime() > nextShortestThread->getBurstTime();
-		kernel->scheduler->ReadyToRun(nextShortestThread);
-		if (shouldYield)
-		{
-            		interrupt->YieldOnReturn();// 做context switch(換下一組code上來)
-		}
-
-		kernel->interrupt->SetLevel(oldLevel);
-            }
+    } else if (tickless && idle && !woken) {
+        if (scheduler->readyListEmpty())
+            stretch = scheduler->nextWakeUp();
+    } else if (tickless && !idle && scheduler->readyListEmpty()) {
+        // nobody to switch to until someone wakes up or is readied
+        stretch = scheduler->sleepingListEmpty() ?
+				0 : scheduler->nextWakeUp();
+    } else if (scheduler->ShouldPreempt(idle)) {// there's someone to preempt
+        interrupt->YieldOnReturn();// 做context switch(換下一組code上來)
+    }
+    if (tickless) {
+	Arm();
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::Arm
+//	Tickless mode only: schedule the next timer interrupt, "stretch"
+//	time slices from now, or none at all if "stretch" is 0.
+//----------------------------------------------------------------------
+
+void
+Alarm::Arm()
+{
+    armedAt = kernel->stats->totalTicks;
+    if (stretch > 0) {
+	armed = kernel->interrupt->Schedule(this, TimerTicks * stretch,
+					    TimerInt);
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::Resume
+//	Tickless mode only: go back to one interrupt per time slice,
+//	after CallBack stretched the current interval.  The next
+//	interrupt comes on the boundary of the time slice we are in, as
+//	if the timer had been ticking all along.
+//
+// Returns:
+//	The number of whole time slices since the stretched interval
+//	began; the caller accounts for these as if they had interrupted.
+//----------------------------------------------------------------------
+
+int
+Alarm::Resume()
+{
+    long long elapsed;
+    int gone;
+
+    if (!IsStretched()) {
+	return 0;
+    }
+    elapsed = kernel->stats->totalTicks - armedAt;
+    gone = elapsed / TimerTicks;
+    if (armed != NULL) {
+	kernel->interrupt->Cancel(armed);
     }
+    DEBUG(dbgInt, "Timer resuming after " << gone << " idle time slices");
+
+    stretch = 1;
+    armed = kernel->interrupt->Schedule(this, TimerTicks - (int) (elapsed % TimerTicks),
+					TimerInt);
+    armedAt = kernel->stats->totalTicks - elapsed % TimerTicks;
+    return gone;
 }
 
 //----------------------------------------------------------------------
@@ -100,8 +189,51 @@ void Alarm::WaitUntil(int x) {
     // t->setBurstTime(t->getBurstTime() + worktime);
     // t->setStartTime(kernel->stats->userTicks); // 因為新的burstTime是根據上一個startTime
     // cout << "userticks = "<< kernel->stats->userTicks << endl;
-    cout << "Alarm::WaitUntil go sleep" << endl;
+    DEBUG(dbgThread, "Alarm::WaitUntil go sleep: " << t->getName());
+    Rearm();	// the timer must be running to wake us up again
     kernel->scheduler->PutToSleep(t,x);
     //開中斷
     kernel->interrupt->SetLevel(oldLevel);
 }
+
+//----------------------------------------------------------------------
+// Alarm::LeaveIdle
+//	Called when a thread has become ready to run after the machine
+//	was idle.  If we were skipping time slices while idle, bring
+//	the timer back to one interrupt per time slice, and
+//	count the slices that went by (no sleeper can be due yet: the
+//	timer was stretched only up to the first one).
+//----------------------------------------------------------------------
+void Alarm::LeaveIdle()
+{
+    if (tickless && IsStretched()) {
+	kernel->scheduler->anyThreadWoken(Resume());
+    }
+}
+
+//----------------------------------------------------------------------
+// Alarm::Rearm
+//	If we were skipping time slices (or had no timer interrupt
+//	coming at all), go back to one interrupt per time slice: a
+//	thread has become ready, or is going to sleep.  Slices that went
+//	by while a thread ran are charged to it, as if the timer had
+//	interrupted; idle ones are not (see LeaveIdle).
+//	Called with interrupts disabled.
+//----------------------------------------------------------------------
+void Alarm::Rearm()
+{
+    int gone;
+
+    if (!tickless || !IsStretched()) {
+	return;
+    }
+    if (kernel->interrupt->getStatus() == IdleMode) {
+	LeaveIdle();		// a device handler readied a thread
+	return;
+    }
+    gone = Resume();
+    kernel->scheduler->anyThreadWoken(gone);
+    if (gone > 0) {
+	kernel->scheduler->Tick(gone, FALSE);
+    }
+}
@@ -8,6 +8,12 @@
 //	From this, we provide the ability for a thread to be
 //	woken up after a delay; we also provide time-slicing.
 //
+//	In tickless mode the periodic timer device is not used.  The
+//	alarm schedules each timer interrupt itself, as a one-shot, so
+//	that it can put the next one off by several time slices (or
+//	indefinitely) and take it back again; the hardware timer has
+//	no way to do either.
+//
 //	NOTE: this abstraction is not completely implemented.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
@@ -24,20 +30,43 @@
 #include <list>
 #include "thread.h"
 
+class PendingInterrupt;
+
 // The following class defines a software alarm clock. 
 class Alarm : public CallBackObj {
   public:
-    Alarm(bool doRandomYield);	// Initialize the timer, and callback 
+    Alarm(bool doRandomYield, bool tickless = FALSE);
+    				// Initialize the timer, and callback 
 				// to "toCall" every time slice.
     ~Alarm() { delete timer; }
     
     void WaitUntil(int x);	// suspend execution until time > now + x
+    void LeaveIdle();		// a thread is ready after the machine
+    				// idled; restart time slicing
+    void Rearm();		// a thread is ready, or going to sleep;
+    				// restart time slicing
 
   private:
-    Timer *timer;		// the hardware timer device
+    Timer *timer;		// the hardware timer device; NULL
+				// in tickless mode
+    bool tickless;		// skip timer interrupts while idle, or
+				// while one thread has the CPU to itself
     // sleepList _sleepList;
     void CallBack();		// called when the hardware
 				// timer generates an interrupt
+
+    // tickless mode only: the one-shot timer interrupt
+    int stretch;		// time slices the pending interrupt
+				// covers; 0 if none is pending
+    int slices;			// time slices the interrupt being
+				// handled covers
+    long long armedAt;		// when the pending interrupt was set
+    PendingInterrupt *armed;	// the pending interrupt, if any
+
+    void Arm();			// schedule the next interrupt
+    bool IsStretched() { return stretch != 1; }
+    int Resume();		// go back to one interrupt per time
+				// slice; return the slices gone by
 };
 
 #endif // ALARM_H
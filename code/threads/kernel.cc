@@ -14,6 +14,7 @@
 #include "synchlist.h"
 #include "libtest.h"
 #include "elevatortest.h"
+#include "synchbench.h"
 #include "string.h"
 
 //----------------------------------------------------------------------
@@ -25,6 +26,13 @@
 ThreadedKernel::ThreadedKernel(int argc, char **argv)
 {
     randomSlice = FALSE; 
+    ticklessIdle = FALSE;
+    burstAlpha = 0.0;
+    printMetrics = FALSE;
+    metricsFile = NULL;
+    benchIterations = 0;
+    lockTest = FALSE;
+    synchProfiler = NULL;
     type = RR;
     pfType = FCFS;
     for (int i = 1; i < argc; i++) {
@@ -35,8 +43,39 @@ ThreadedKernel::ThreadedKernel(int argc, char **argv)
 	        randomSlice = TRUE;
 	        i++;
         } 
+        else if (strcmp(argv[i], "-tickless") == 0) {
+            ticklessIdle = TRUE;
+        }
+        else if (strcmp(argv[i], "-predict") == 0) {
+            ASSERT(i + 1 < argc);
+            burstAlpha = atof(argv[i + 1]);	// weight of the last burst
+            ASSERT(burstAlpha > 0.0 && burstAlpha <= 1.0);
+            i++;
+        }
+        else if (strcmp(argv[i], "-metrics") == 0) {
+            printMetrics = TRUE;
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                metricsFile = argv[i + 1];	// optional CSV file name
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "-bench") == 0) {
+            benchIterations = 1000;
+            if (i + 1 < argc && atoi(argv[i + 1]) > 0) {
+                benchIterations = atoi(argv[i + 1]);	// optional count
+                i++;
+            }
+        }
+        else if (strcmp(argv[i], "-lockprof") == 0) {
+            synchProfiler = new SynchProfiler;	// report at halt
+        }
+        else if (strcmp(argv[i], "-locktest") == 0) {
+            lockTest = TRUE;		// with -PRIORITY
+        }
         else if (strcmp(argv[i], "-u") == 0) {
-            cout << "Partial usage: nachos [-rs randomSeed]\n";
+            cout << "Partial usage: nachos [-rs randomSeed] [-tickless] [-predict alpha]\n";
+            cout << "Partial usage: nachos [-bench [iterations]] [-metrics [file.csv]]\n";
+            cout << "Partial usage: nachos [-lockprof] [-locktest]\n";
 	    } 
         else if(strcmp(argv[i], "-RR") == 0) {
             type = RR;
@@ -48,6 +87,14 @@ ThreadedKernel::ThreadedKernel(int argc, char **argv)
             type = SJF;
         } else if(strcmp(argv[i], "-SRTF") == 0){
             type = SRTF;
+        } else if (strcmp(argv[i], "-MLFQ") == 0) {
+            type = MLFQ;
+        } else if (strcmp(argv[i], "-STRIDE") == 0) {
+            type = Stride;
+        } else if (strcmp(argv[i], "-LOTTERY") == 0) {
+            type = Lottery;
+        } else if (strcmp(argv[i], "-EDF") == 0) {
+            type = EDF;
         } 
 
 
@@ -79,7 +126,9 @@ ThreadedKernel::Initialize()
     stats = new Statistics();		// collect statistics
     interrupt = new Interrupt;		// start up interrupt handling
     scheduler = new Scheduler(type);	// initialize the ready queue
-    alarm = new Alarm(randomSlice);	// start up time slicing
+    scheduler->setBurstAlpha(burstAlpha);
+    scheduler->setMetricsFile(metricsFile);
+    alarm = new Alarm(randomSlice, ticklessIdle);	// start up time slicing
 
     // We didn't explicitly allocate the current thread we are running in.
     // But if it ever tries to give up the CPU, we better have a Thread
@@ -94,7 +143,9 @@ void ThreadedKernel::Initialize(SchedulerType type){
     stats = new Statistics();		// collect statistics
     interrupt = new Interrupt;		// start up interrupt handling
     scheduler = new Scheduler(type);	// initialize the ready queue
-    alarm = new Alarm(randomSlice);	// start up time slicing
+    scheduler->setBurstAlpha(burstAlpha);
+    scheduler->setMetricsFile(metricsFile);
+    alarm = new Alarm(randomSlice, ticklessIdle);	// start up time slicing
 
     // We didn't explicitly allocate the current thread we are running in.
     // But if it ever tries to give up the CPU, we better have a Thread
@@ -116,6 +167,7 @@ ThreadedKernel::~ThreadedKernel()
     delete scheduler;
     delete interrupt;
     delete stats;
+    delete synchProfiler;
     
     Exit(0);
 }
@@ -152,6 +204,16 @@ ThreadedKernel::SelfTest() {
    
    //LibSelfTest();		// test library routines
    
+   if (benchIterations > 0) {	// measure instead of testing
+      SynchBenchmark(benchIterations);
+      return;
+   }
+   if (lockTest) {		// test lock hand-off by priority
+      Lock *lock = new Lock("test");
+      lock->SelfTest();
+      delete lock;
+      return;
+   }
    currentThread->SelfTest();	// test thread switching
    // Thread::SelfTest();
    				// test semaphore operation
@@ -17,6 +17,7 @@
 #include "stats.h"
 #include "alarm.h"
 #include "translate.h"
+#include "synchprof.h"
 
 
 class ThreadedKernel {
@@ -44,9 +45,19 @@ class ThreadedKernel {
     Interrupt *interrupt;	// interrupt status
     Statistics *stats;		// performance metrics
     Alarm *alarm;		// the software alarm clock    
+    SynchProfiler *synchProfiler;	// lock contention statistics,
+				// or NULL if not profiling
+    bool printMetrics;		// summarize scheduling at halt
     PageFaultType pfType;
   private:
     bool randomSlice;		// enable pseudo-random time slicing
+    bool ticklessIdle;		// skip timer interrupts while idle
+    double burstAlpha;		// CPU burst prediction weight, 0 = off
+    char *metricsFile;		// per-thread CSV written at halt, or NULL
+    int benchIterations;	// run the benchmarks this many times,
+				// instead of the self test; 0 = don't
+    bool lockTest;		// run Lock::SelfTest instead of the
+				// scheduler self test
     SchedulerType type;
     
 };
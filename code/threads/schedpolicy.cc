@@ -0,0 +1,854 @@
+// schedpolicy.cc
+//	Routines for the scheduling policies: how each one keeps its
+//	ready threads, picks the next one to run, and decides whether
+//	to preempt the running thread.
+//
+//	Preemption checks only look at the front of the ready queue
+//	(a list head, the top of a heap, or the lowest bit of a bitmap),
+//	so they cost O(1) on every timer interrupt.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "schedpolicy.h"
+#include "main.h"
+#include "sysdep.h"
+#include <limits.h>
+
+//--------------------------------------------------------
+// 自定義函數，印出Thread的名稱及burstTime
+//--------------------------------------------------------
+void PrintThreadBurstTime(Thread *t) {
+    t->Print();
+    printf(" burstTime: %d    ",t->getExpectedBurst());
+}
+
+//----------------------------------------------------------------------
+// Compare function
+//----------------------------------------------------------------------
+int SJFCompare(Thread *a, Thread *b) {
+    if(a->getExpectedBurst() == b->getExpectedBurst())
+        return 0;
+    return a->getExpectedBurst() > b->getExpectedBurst() ? 1 : -1;
+}
+int PriorityCompare(Thread *a, Thread *b) {
+    if(a->getPriority() == b->getPriority())
+        return 0;
+    return a->getPriority() > b->getPriority() ? 1 : -1;
+}
+
+//----------------------------------------------------------------------
+// StrideCompare
+// 	Order threads by pass; threads with the same pass run in the
+//	order they became ready.
+//----------------------------------------------------------------------
+
+static int
+StrideCompare(Thread *a, Thread *b)
+{
+    if (a->getPass() != b->getPass())
+	return a->getPass() > b->getPass() ? 1 : -1;
+    if (a->getReadySeq() != b->getReadySeq())
+	return a->getReadySeq() > b->getReadySeq() ? 1 : -1;
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// EDFCompare
+// 	Order threads by deadline.  Threads that are not real-time come
+//	after every real-time one; ties, and threads that are not
+//	real-time, run in the order they became ready.
+//----------------------------------------------------------------------
+
+static long long
+EDFDeadline(Thread *t)
+{
+    return t->getRealTime() != NULL ? t->getRealTime()->deadline : LLONG_MAX;
+}
+
+static int
+EDFCompare(Thread *a, Thread *b)
+{
+    if (EDFDeadline(a) != EDFDeadline(b))
+	return EDFDeadline(a) > EDFDeadline(b) ? 1 : -1;
+    if (a->getReadySeq() != b->getReadySeq())
+	return a->getReadySeq() > b->getReadySeq() ? 1 : -1;
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// PrintThreadPriority, PrintThreadTickets, PrintThreadLevel,
+// PrintThreadDeadline
+// 	Print a thread's name and what the policy sorts it on, for
+//	debugging.
+//----------------------------------------------------------------------
+
+static void
+PrintThreadPriority(Thread *t)
+{
+    t->Print();
+    printf(" priority: %d    ", t->getPriority());
+}
+
+static void
+PrintThreadTickets(Thread *t)
+{
+    t->Print();
+    cout << " tickets: " << t->getTickets() << " pass: " << t->getPass() << "    ";
+}
+
+static void
+PrintThreadLevel(Thread *t)
+{
+    t->Print();
+    printf(" level: %d    ", t->getLevel());
+}
+
+static void
+PrintThreadDeadline(Thread *t)
+{
+    t->Print();
+    if (t->getRealTime() != NULL)
+	printf(" deadline: %lld    ", t->getRealTime()->deadline);
+    else
+	printf(" deadline: none    ");
+}
+
+//----------------------------------------------------------------------
+// FIFOPolicy::PickNext, FIFOPolicy::Print
+// 	Take the thread that has been ready longest; print the ready
+//	list in order.
+//----------------------------------------------------------------------
+
+Thread *
+FIFOPolicy::PickNext()
+{
+    if (readyList->IsEmpty())
+	return NULL;
+    return readyList->RemoveFront();
+}
+
+void
+FIFOPolicy::Print()
+{
+    readyList->Apply(PrintThreadBurstTime);
+}
+
+//----------------------------------------------------------------------
+// SortedPolicy::PickNext, SortedPolicy::Print
+// 	Take the smallest thread; print the ready list in order.
+//----------------------------------------------------------------------
+
+Thread *
+SortedPolicy::PickNext()
+{
+    if (readyList->IsEmpty())
+	return NULL;
+    return readyList->RemoveFront();
+}
+
+void
+SortedPolicy::Print()
+{
+    readyList->Apply(PrintThreadBurstTime);
+}
+
+SJFPolicy::SJFPolicy() : SortedPolicy("SJF", SJFCompare) {}
+
+SRTFPolicy::SRTFPolicy() : SortedPolicy("SRTF", SJFCompare) {}
+
+//----------------------------------------------------------------------
+// SRTFPolicy::ShouldPreempt
+// 	Preempt if the shortest ready thread is expected to finish its
+//	burst sooner than the current thread will finish what is left
+//	of its own.
+//----------------------------------------------------------------------
+
+bool
+SRTFPolicy::ShouldPreempt(Thread *current, bool idle)
+{
+    Scheduler *scheduler = kernel->scheduler;
+
+    if (readyList->IsEmpty())
+	return FALSE;
+    return scheduler->RemainingBurst(current) > scheduler->RemainingBurst(readyList->Front());
+}
+
+PriorityPolicy::PriorityPolicy() : SortedPolicy("Priority", PriorityCompare) {}
+
+//----------------------------------------------------------------------
+// PriorityPolicy::OnTick
+// 	Age the current thread: each timer interrupt lowers its base
+//	priority (which, smaller being better, makes it more urgent).
+//----------------------------------------------------------------------
+
+void
+PriorityPolicy::OnTick(Thread *current, int slices, bool idle)
+{
+    current->setPriority(current->getBasePriority() - slices); //為何要-1
+}
+
+//----------------------------------------------------------------------
+// PriorityPolicy::Donate
+// 	Set the priority "thread" inherits from the threads waiting on
+//	its locks.  A ready thread is taken off the sorted ready list
+//	and put back, so that it sits where its new priority belongs.
+//----------------------------------------------------------------------
+
+void
+PriorityPolicy::Donate(Thread *thread, int priority)
+{
+    if (thread->getStatus() == READY) {
+	readyList->Remove(thread);
+	thread->setDonatedPriority(priority);
+	readyList->Insert(thread);
+    } else {
+	thread->setDonatedPriority(priority);
+    }
+}
+
+void
+PriorityPolicy::Print()
+{
+    readyList->Apply(PrintThreadPriority);
+}
+
+//----------------------------------------------------------------------
+// MLFQPolicy::MLFQPolicy
+// 	Start with every level empty.
+//----------------------------------------------------------------------
+
+MLFQPolicy::MLFQPolicy() : SchedPolicy("MLFQ")
+{
+    mask = 0;
+    epoch = 0;
+    boostCountdown = MLFQBoostPeriod;
+    expired = FALSE;
+}
+
+//----------------------------------------------------------------------
+// MLFQPolicy::Refresh
+// 	Bring a thread's MLFQ state up to date.  Priority boosts only
+//	bump the epoch and move the queues in bulk; a thread whose epoch
+//	is stale (or that has never been scheduled) is lazily reset to
+//	level 0 with a full quantum the next time we look at it.
+//----------------------------------------------------------------------
+
+void
+MLFQPolicy::Refresh(Thread *thread)
+{
+    if (thread->getBoostEpoch() != epoch) {
+	thread->setLevel(0);
+	thread->setQuantumLeft(MLFQQuantum(0));
+	thread->setBoostEpoch(epoch);
+    }
+}
+
+//----------------------------------------------------------------------
+// MLFQPolicy::Boost
+// 	Move every ready thread to level 0, so that CPU-bound threads
+//	that sank to the bottom levels cannot be starved.  Splicing the
+//	per-level lists is O(1) each; the threads' own level fields are
+//	fixed up lazily by Refresh.
+//----------------------------------------------------------------------
+
+void
+MLFQPolicy::Boost()
+{
+    for (int i = 1; i < MLFQLevels; i++)
+	queue[0].splice(queue[0].end(), queue[i]);
+    mask = queue[0].empty() ? 0 : 1;
+    epoch++;
+    DEBUG(dbgScheduler, "MLFQ priority boost, epoch " << epoch);
+}
+
+//----------------------------------------------------------------------
+// MLFQPolicy::Enqueue, MLFQPolicy::PickNext
+// 	Append to the queue for the thread's level; take from the
+//	highest non-empty level.
+//----------------------------------------------------------------------
+
+void
+MLFQPolicy::Enqueue(Thread *thread)
+{
+    Refresh(thread);
+    queue[thread->getLevel()].push_back(thread);
+    mask |= (1u << thread->getLevel());
+}
+
+Thread *
+MLFQPolicy::PickNext()
+{
+    if (mask == 0)
+	return NULL;
+    // the lowest set bit is the highest priority non-empty level
+    int top = __builtin_ctz(mask);
+    Thread *thread = queue[top].front();
+    queue[top].pop_front();
+    if (queue[top].empty())
+	mask &= ~(1u << top);
+    Refresh(thread);			// may have been boosted while queued
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// MLFQPolicy::OnTick
+// 	Charge the interrupt (one time slice for each of "slices")
+//	against the current thread's quantum, demoting it one level each
+//	time the quantum is used up, and boost all threads periodically.
+//	Nothing is charged while idle.
+//----------------------------------------------------------------------
+
+void
+MLFQPolicy::OnTick(Thread *current, int slices, bool idle)
+{
+    expired = FALSE;
+    if (idle)
+	return;
+    for (int i = 0; i < slices; i++) {
+	if (--boostCountdown <= 0) {
+	    Boost();
+	    boostCountdown = MLFQBoostPeriod;
+	}
+
+	Refresh(current);
+	current->setQuantumLeft(current->getQuantumLeft() - 1);
+	if (current->getQuantumLeft() <= 0) {
+	    expired = TRUE;
+	    if (current->getLevel() < MLFQLevels - 1)
+		current->setLevel(current->getLevel() + 1);
+	    current->setQuantumLeft(MLFQQuantum(current->getLevel()));
+	    DEBUG(dbgScheduler, "MLFQ demote " << current->getName()
+		    << " to level " << current->getLevel());
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// MLFQPolicy::ShouldPreempt
+// 	Preempt if a higher level has a ready thread, or if the quantum
+//	just expired and some thread at the same (or a higher) level is
+//	waiting.
+//----------------------------------------------------------------------
+
+bool
+MLFQPolicy::ShouldPreempt(Thread *current, bool idle)
+{
+    if (idle || mask == 0)
+	return FALSE;
+    int top = __builtin_ctz(mask);
+    return expired ? (top <= current->getLevel()) : (top < current->getLevel());
+}
+
+//----------------------------------------------------------------------
+// MLFQPolicy::Print
+//----------------------------------------------------------------------
+
+void
+MLFQPolicy::Print()
+{
+    for (int i = 0; i < MLFQLevels; i++) {
+	std::list<Thread *>::iterator it;
+	for (it = queue[i].begin(); it != queue[i].end(); it++)
+	    PrintThreadLevel(*it);
+    }
+}
+
+//----------------------------------------------------------------------
+// StridePolicy::StridePolicy
+//----------------------------------------------------------------------
+
+StridePolicy::StridePolicy() : SchedPolicy("Stride")
+{
+    heap = new Heap<Thread *>(StrideCompare);
+    globalPass = 0;
+    dispatchedAt = 0;
+    readySeq = 0;
+}
+
+//----------------------------------------------------------------------
+// StridePolicy::Charge
+// 	Advance the pass of the running thread by the CPU time it has
+//	used since it was dispatched (or last charged), in proportion
+//	to its stride, StrideOne / tickets.
+//----------------------------------------------------------------------
+
+void
+StridePolicy::Charge(Thread *thread)
+{
+    long long now = kernel->stats->totalTicks;
+    long long stride = StrideOne / thread->getTickets();
+
+    thread->setPass(thread->getPass() + stride * (now - dispatchedAt) / TimerTicks);
+    dispatchedAt = now;
+}
+
+//----------------------------------------------------------------------
+// StridePolicy::Enqueue
+// 	A yielding thread pays for its turn first; a thread coming back
+//	after blocking gets no credit for the time it was away.
+//----------------------------------------------------------------------
+
+void
+StridePolicy::Enqueue(Thread *thread)
+{
+    if (thread == kernel->currentThread) {
+	Charge(thread);
+    } else if (thread->getPass() < globalPass) {
+	thread->setPass(globalPass);
+    }
+    thread->setReadySeq(readySeq++);
+    heap->Insert(thread);
+}
+
+Thread *
+StridePolicy::PickNext()
+{
+    if (heap->IsEmpty())
+	return NULL;
+    return heap->RemoveFront();
+}
+
+//----------------------------------------------------------------------
+// StridePolicy::OnTick, StridePolicy::ShouldPreempt
+// 	Preempt the current thread once some ready thread has a lower
+//	pass than it has after being charged for this tick.
+//----------------------------------------------------------------------
+
+void
+StridePolicy::OnTick(Thread *current, int slices, bool idle)
+{
+    if (!idle && !heap->IsEmpty())
+	Charge(current);
+}
+
+bool
+StridePolicy::ShouldPreempt(Thread *current, bool idle)
+{
+    if (idle || heap->IsEmpty())
+	return FALSE;
+    return heap->Front()->getPass() < current->getPass();
+}
+
+//----------------------------------------------------------------------
+// StridePolicy::OnDispatch
+// 	"thread" is about to run: it sets the pass that threads coming
+//	back from being blocked will start from.
+//----------------------------------------------------------------------
+
+void
+StridePolicy::OnDispatch(Thread *thread)
+{
+    globalPass = thread->getPass();
+    dispatchedAt = kernel->stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// StridePolicy::SetTickets
+// 	CPU time already used is charged at the old rate.
+//----------------------------------------------------------------------
+
+void
+StridePolicy::SetTickets(Thread *thread, int tickets)
+{
+    if (thread == kernel->currentThread)
+	Charge(thread);
+    thread->setTickets(tickets);
+}
+
+void
+StridePolicy::Print()
+{
+    heap->Apply(PrintThreadTickets);
+}
+
+//----------------------------------------------------------------------
+// LotteryPolicy::Enqueue, LotteryPolicy::SetTickets
+// 	Keep the total number of tickets on the ready list up to date.
+//----------------------------------------------------------------------
+
+void
+LotteryPolicy::Enqueue(Thread *thread)
+{
+    totalTickets += thread->getTickets();
+    readyList->Append(thread);
+}
+
+void
+LotteryPolicy::SetTickets(Thread *thread, int tickets)
+{
+    if (thread->getStatus() == READY)
+	totalTickets += tickets - thread->getTickets();
+    thread->setTickets(tickets);
+}
+
+//----------------------------------------------------------------------
+// LotteryPolicy::PickNext
+// 	Hold a lottery among the ready threads: draw one of the tickets
+//	they hold, and remove and return the thread holding it.  Linear
+//	in the length of the ready list.
+//----------------------------------------------------------------------
+
+Thread *
+LotteryPolicy::PickNext()
+{
+    if (readyList->IsEmpty())
+	return NULL;
+
+    int winner = RandomNumber() % totalTickets;
+    ListIterator<Thread *> it(readyList);
+    Thread *thread;
+
+    for (;;) {
+	thread = it.Item();
+	winner -= thread->getTickets();
+	if (winner < 0)
+	    break;
+	it.Next();
+    }
+    readyList->Remove(thread);
+    totalTickets -= thread->getTickets();
+    return thread;
+}
+
+void
+LotteryPolicy::Print()
+{
+    readyList->Apply(PrintThreadTickets);
+}
+
+//----------------------------------------------------------------------
+// RTTask::RTTask
+// 	The real-time parameters of thread "t".  Its first job is due
+//	one period from now.
+//----------------------------------------------------------------------
+
+RTTask::RTTask(Thread *t, int taskPeriod, int taskBudget)
+{
+    thread = t;
+    name = t->getName();
+    period = taskPeriod;
+    budget = taskBudget;
+    deadline = jobDeadline = kernel->stats->totalTicks + period;
+    budgetLeft = budget;
+    jobs = misses = overruns = 0;
+    maxLateness = 0;
+    for (int i = 0; i < LatenessBuckets; i++)
+	lateness[i] = 0;
+}
+
+//----------------------------------------------------------------------
+// RTTask::CallBack
+// 	The next period has started: wake the thread up for its next
+//	job, and have it preempt the running thread if its deadline is
+//	earlier.
+//----------------------------------------------------------------------
+
+void
+RTTask::CallBack()
+{
+    DEBUG(dbgScheduler, "EDF release " << name << ", due " << deadline);
+    kernel->scheduler->ReadyToRun(thread);
+    if (kernel->interrupt->getStatus() != IdleMode
+		&& kernel->scheduler->ShouldPreempt(FALSE))
+	kernel->interrupt->YieldOnReturn();
+}
+
+//----------------------------------------------------------------------
+// EDFPolicy::EDFPolicy, EDFPolicy::~EDFPolicy
+//----------------------------------------------------------------------
+
+EDFPolicy::EDFPolicy() : SchedPolicy("EDF")
+{
+    heap = new Heap<Thread *>(EDFCompare);
+    readySeq = 0;
+    utilization = 0.0;
+    rejected = 0;
+    budgetTimer = NULL;
+    dispatchedAt = 0;
+}
+
+EDFPolicy::~EDFPolicy()
+{
+    delete heap;
+    for (unsigned int i = 0; i < tasks.size(); i++)
+	delete tasks[i];
+}
+
+//----------------------------------------------------------------------
+// EDFPolicy::Arm, EDFPolicy::Disarm
+// 	Schedule an interrupt for when the budget of "thread", which is
+//	about to run (or keep running), is used up; cancel it when the
+//	thread gives up the CPU first.
+//----------------------------------------------------------------------
+
+void
+EDFPolicy::Arm(Thread *thread)
+{
+    ASSERT(budgetTimer == NULL);
+    if (thread->getRealTime() != NULL)
+	budgetTimer = kernel->interrupt->Schedule(this,
+				thread->getRealTime()->budgetLeft, TimerInt);
+}
+
+void
+EDFPolicy::Disarm()
+{
+    if (budgetTimer != NULL) {
+	kernel->interrupt->Cancel(budgetTimer);
+	budgetTimer = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// EDFPolicy::Charge
+// 	Take the CPU the running thread used since dispatch (or since it
+//	was last charged) out of its budget.  Once the budget is gone,
+//	the job has overrun: its deadline is pushed back a period, with
+//	a fresh budget, so it now competes as if it were the next job.
+//----------------------------------------------------------------------
+
+void
+EDFPolicy::Charge(Thread *thread)
+{
+    RTTask *task = thread->getRealTime();
+    long long now = kernel->stats->totalTicks;
+
+    if (task != NULL) {
+	task->budgetLeft -= now - dispatchedAt;
+	if (task->budgetLeft <= 0) {
+	    task->overruns++;
+	    task->deadline += task->period;
+	    task->budgetLeft = task->budget;
+	    DEBUG(dbgScheduler, "EDF overrun " << task->name
+		<< ", deadline now " << task->deadline);
+	}
+    }
+    dispatchedAt = now;
+}
+
+//----------------------------------------------------------------------
+// EDFPolicy::Enqueue, EDFPolicy::PickNext
+// 	A yielding thread is charged for its turn first.  While the
+//	machine is idle, the current thread is the one that went to
+//	sleep; it has been charged already, and is not using the CPU.
+//----------------------------------------------------------------------
+
+void
+EDFPolicy::Enqueue(Thread *thread)
+{
+    if (thread == kernel->currentThread
+		&& kernel->interrupt->getStatus() != IdleMode) {
+	Disarm();
+	Charge(thread);
+    }
+    thread->setReadySeq(readySeq++);
+    heap->Insert(thread);
+}
+
+Thread *
+EDFPolicy::PickNext()
+{
+    if (heap->IsEmpty())
+	return NULL;
+    return heap->RemoveFront();
+}
+
+//----------------------------------------------------------------------
+// EDFPolicy::ShouldPreempt
+// 	Preempt the current thread as soon as a thread with an earlier
+//	deadline is ready.
+//----------------------------------------------------------------------
+
+bool
+EDFPolicy::ShouldPreempt(Thread *current, bool idle)
+{
+    if (idle || heap->IsEmpty())
+	return FALSE;
+    return EDFDeadline(heap->Front()) < EDFDeadline(current);
+}
+
+//----------------------------------------------------------------------
+// EDFPolicy::OnBlock, EDFPolicy::OnDispatch, EDFPolicy::OnFinish
+// 	Start and stop the budget timer as real-time threads come and
+//	go, and give back the utilization of one that finishes.
+//----------------------------------------------------------------------
+
+void
+EDFPolicy::OnBlock(Thread *thread)
+{
+    Disarm();
+    Charge(thread);
+}
+
+void
+EDFPolicy::OnDispatch(Thread *thread)
+{
+    dispatchedAt = kernel->stats->totalTicks;
+    Arm(thread);
+}
+
+void
+EDFPolicy::OnFinish(Thread *thread)
+{
+    RTTask *task = thread->getRealTime();
+
+    if (task != NULL)
+	utilization -= (double) task->budget / task->period;
+}
+
+//----------------------------------------------------------------------
+// EDFPolicy::CallBack
+// 	The budget timer went off: the running thread has used up its
+//	budget.  Charge it (which postpones its deadline), keep the
+//	timer going in case it stays on the CPU, and ask for a
+//	reschedule when the interrupt handler returns.
+//----------------------------------------------------------------------
+
+void
+EDFPolicy::CallBack()
+{
+    Thread *current = kernel->currentThread;
+
+    budgetTimer = NULL;			// the interrupt is used up
+    Charge(current);
+    Arm(current);
+    kernel->interrupt->YieldOnReturn();
+}
+
+//----------------------------------------------------------------------
+// EDFPolicy::Admit
+// 	Make "thread" real-time, with a job of at most "budget" ticks
+//	every "period" ticks, if that keeps the total utilization of
+//	the admitted threads at or below 1, the bound under which EDF
+//	meets every deadline.
+//
+//	Returns FALSE, and leaves the thread alone, if it does not fit.
+//----------------------------------------------------------------------
+
+bool
+EDFPolicy::Admit(Thread *thread, int period, int budget)
+{
+    double u = (double) budget / period;
+
+    if (thread->getRealTime() != NULL || budget <= 0 || budget > period
+		|| utilization + u > 1.0 + 1e-9) {
+	rejected++;
+	DEBUG(dbgScheduler, "EDF reject " << thread->getName()
+		<< ": utilization " << utilization << " + " << u);
+	return FALSE;
+    }
+    utilization += u;
+
+    RTTask *task = new RTTask(thread, period, budget);
+    tasks.push_back(task);
+    if (thread == kernel->currentThread) {
+	thread->setRealTime(task);	// its budget starts now
+	dispatchedAt = kernel->stats->totalTicks;
+	Arm(thread);
+    } else {
+	ASSERT(thread->getStatus() != READY);	// would be out of order
+	thread->setRealTime(task);
+    }
+    DEBUG(dbgScheduler, "EDF admit " << thread->getName() << ": period "
+	<< period << ", budget " << budget << ", utilization " << utilization);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// EDFPolicy::EndJob
+// 	The running real-time thread has finished its current job.
+//	Record how late it was, and set up the next job, which is
+//	released when this one was due and is due a period later.
+//	If that is still in the future, schedule an interrupt to wake
+//	the thread up then.
+//
+//	Returns the number of ticks until the next job is released, or
+//	0 if it has been released already.
+//----------------------------------------------------------------------
+
+int
+EDFPolicy::EndJob(Thread *thread)
+{
+    RTTask *task = thread->getRealTime();
+    long long now = kernel->stats->totalTicks;
+    int late, bucket;
+
+    ASSERT(task != NULL && thread == kernel->currentThread);
+    Disarm();
+    Charge(thread);
+
+    task->jobs++;
+    late = now - task->jobDeadline;
+    if (late > 0) {
+	task->misses++;
+	if (late > task->maxLateness)
+	    task->maxLateness = late;
+	for (bucket = 1; bucket < LatenessBuckets - 1; bucket++) {
+	    if (late <= TimerTicks << (bucket - 1))
+		break;
+	}
+	task->lateness[bucket]++;
+	DEBUG(dbgScheduler, "EDF miss " << task->name << " by " << late);
+    } else {
+	task->lateness[0]++;
+    }
+
+    long long release = task->jobDeadline;
+    task->deadline = task->jobDeadline = release + task->period;
+    task->budgetLeft = task->budget;
+    if (release > now) {
+	kernel->interrupt->Schedule(task, release - now, TimerInt);
+	return release - now;
+    }
+    Arm(thread);			// next job is already due; keep going
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// EDFPolicy::Print
+//----------------------------------------------------------------------
+
+void
+EDFPolicy::Print()
+{
+    heap->Apply(PrintThreadDeadline);
+}
+
+//----------------------------------------------------------------------
+// EDFPolicy::Report
+// 	Print, for every real-time thread, how many jobs it completed,
+//	how many of them missed their deadline, how often it overran its
+//	budget, and a histogram of how late its jobs were.
+//----------------------------------------------------------------------
+
+void
+EDFPolicy::Report()
+{
+    double total = 0.0;
+
+    for (unsigned int i = 0; i < tasks.size(); i++)
+	total += (double) tasks[i]->budget / tasks[i]->period;
+    cout << "EDF: admitted " << tasks.size() << ", rejected " << rejected
+	<< ", utilization " << total << "\n";
+    for (unsigned int i = 0; i < tasks.size(); i++) {
+	RTTask *task = tasks[i];
+
+	cout << "  " << task->name << ": period " << task->period
+	    << ", budget " << task->budget << ", jobs " << task->jobs
+	    << ", missed " << task->misses << ", overruns " << task->overruns
+	    << ", max lateness " << task->maxLateness << "\n";
+	cout << "    lateness: on time " << task->lateness[0];
+	for (int b = 1; b < LatenessBuckets; b++) {
+	    if (b < LatenessBuckets - 1)
+		cout << ", <=" << (TimerTicks << (b - 1)) << " ";
+	    else
+		cout << ", more ";
+	    cout << task->lateness[b];
+	}
+	cout << "\n";
+    }
+}
@@ -0,0 +1,335 @@
+// schedpolicy.h
+//	Scheduling policies: the part of the scheduler that decides
+//	which ready thread runs next, and when the running thread
+//	should be preempted.
+//
+//	The Scheduler owns exactly one policy, chosen when it is
+//	created, and calls it at a handful of fixed points:
+//
+//	  Enqueue	a thread has become ready (Scheduler::ReadyToRun)
+//	  PickNext	remove and return the thread to run next
+//	  OnTick	a timer interrupt went off (Alarm::CallBack)
+//	  ShouldPreempt	right after OnTick: should the current thread
+//			give up the CPU?  Must only peek at the ready
+//			threads, never remove them.
+//	  OnBlock	the running thread is giving up the CPU without
+//			becoming ready (it blocked, slept or finished);
+//			called before the machine goes idle, if it does
+//	  OnDispatch	a thread is about to get the CPU
+//
+//	A new policy is a subclass of SchedPolicy plus one case in
+//	Scheduler::Scheduler; nothing on the interrupt path changes.
+//
+//	All routines are called with interrupts disabled.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SCHEDPOLICY_H
+#define SCHEDPOLICY_H
+
+#include "copyright.h"
+#include "list.h"
+#include "heap.h"
+#include "thread.h"
+#include "callback.h"
+#include <list>
+#include <vector>
+
+class PendingInterrupt;
+
+// Parameters for the multi-level feedback queue.  Level 0 is the
+// highest priority.  A thread that uses up the quantum of its level
+// is demoted one level; every MLFQBoostPeriod timer interrupts, all
+// threads are boosted back to level 0 so that nobody starves.
+// Quanta are measured in timer interrupts (TimerTicks each).
+
+const int MLFQLevels = 8;		// at most the number of bits in
+					// an unsigned int
+const int MLFQBoostPeriod = 50;		// timer interrupts between boosts
+
+inline int MLFQQuantum(int level) { return 1 << level; }
+
+// Parameters for proportional-share scheduling.  Under Stride, a
+// thread holding t tickets has its pass advanced by StrideOne / t for
+// every TimerTicks of CPU it uses, and the ready thread with the
+// lowest pass runs next.  Under Lottery, each time slice goes to a
+// ready thread drawn at random, weighted by tickets.
+
+const int StrideOne = 1 << 20;		// stride of a one-ticket thread
+const int MaxTickets = 1 << 16;		// keeps strides well above 1
+const int DefaultTickets = 100;
+
+// Earliest deadline first.  A real-time thread declares a period and
+// a budget, both in ticks: every period it runs one job, which may
+// use at most "budget" ticks of CPU and is due by the end of the
+// period.  Lateness of each job is counted in LatenessBuckets
+// buckets: on time, then late by at most TimerTicks, 2 * TimerTicks,
+// 4 * TimerTicks, ..., and the last bucket for anything later.
+//
+// A thread that finishes its job early sleeps until the next period
+// starts; the RTTask is the interrupt handler that wakes it up.
+
+const int LatenessBuckets = 8;
+
+class RTTask : public CallBackObj {
+  public:
+    RTTask(Thread *t, int taskPeriod, int taskBudget);
+
+    void CallBack();		// release the next job
+
+    Thread *thread;
+    char *name;
+    int period;			// in ticks
+    int budget;			// CPU ticks allowed per job
+    long long deadline;		// what the ready heap is ordered on
+    long long jobDeadline;	// when the current job is due; differs
+				// from "deadline" after an overrun
+    int budgetLeft;		// CPU ticks left for the current job
+    int jobs;			// jobs completed
+    int misses;			// ... after their deadline
+    int overruns;		// times the budget ran out
+    int maxLateness;
+    int lateness[LatenessBuckets];
+};
+
+// The interface every policy implements.  "idle" is TRUE when the
+// timer went off while the machine was idle; "current" is then the
+// thread that went idle, not one that is using the CPU.
+
+class SchedPolicy {
+  public:
+    SchedPolicy(char *policyName) { name = policyName; }
+    virtual ~SchedPolicy() {}
+    char *getName() { return name; }
+
+    virtual void Enqueue(Thread *thread) = 0;
+    virtual Thread *PickNext() = 0;	// NULL if no thread is ready
+    virtual void OnTick(Thread *current, int slices, bool idle) {}
+					// "slices" timer interrupts' worth
+					// of time has passed
+    virtual bool ShouldPreempt(Thread *current, bool idle) = 0;
+    virtual void OnBlock(Thread *thread) {}
+    virtual void OnDispatch(Thread *thread) {}
+    virtual void OnFinish(Thread *thread) {}
+					// "thread" is gone for good; called
+					// after OnBlock
+
+    virtual void Donate(Thread *thread, int priority)
+			{ thread->setDonatedPriority(priority); }
+					// "thread" inherits "priority";
+					// may be on the ready queue
+    virtual void SetTickets(Thread *thread, int tickets)
+			{ thread->setTickets(tickets); }
+					// "thread" gets a new CPU share
+
+    virtual bool Admit(Thread *thread, int period, int budget)
+			{ return FALSE; }
+					// make "thread" real-time, if the
+					// policy has room for it
+    virtual int EndJob(Thread *thread) { return 0; }
+					// the real-time thread is done for
+					// this period; returns ticks until
+					// its next period starts
+
+    virtual void Print() = 0;		// print the ready threads
+    virtual void Report() {}		// print statistics, at halt
+
+  private:
+    char *name;
+};
+
+// First come, first served: ready threads run in arrival order, and
+// keep the CPU until they give it up.
+
+class FIFOPolicy : public SchedPolicy {
+  public:
+    FIFOPolicy(char *name = "FIFO") : SchedPolicy(name)
+			{ readyList = new List<Thread *>; }
+    ~FIFOPolicy() { delete readyList; }
+
+    void Enqueue(Thread *thread) { readyList->Append(thread); }
+    Thread *PickNext();
+    bool ShouldPreempt(Thread *current, bool idle) { return FALSE; }
+    void Print();
+
+  protected:
+    List<Thread *> *readyList;
+};
+
+// Round robin: FIFO, but every timer interrupt ends the time slice.
+
+class RRPolicy : public FIFOPolicy {
+  public:
+    RRPolicy() : FIFOPolicy("RR") {}
+
+    bool ShouldPreempt(Thread *current, bool idle) { return TRUE; }
+};
+
+// Ready threads kept in a list sorted by "compare"; the smallest
+// runs first.  Never preempts on its own.
+
+class SortedPolicy : public SchedPolicy {
+  public:
+    SortedPolicy(char *name, int (*compare)(Thread *a, Thread *b))
+			: SchedPolicy(name)
+			{ readyList = new SortedList<Thread *>(compare); }
+    ~SortedPolicy() { delete readyList; }
+
+    void Enqueue(Thread *thread) { readyList->Insert(thread); }
+    Thread *PickNext();
+    bool ShouldPreempt(Thread *current, bool idle) { return FALSE; }
+    void Print();
+
+  protected:
+    SortedList<Thread *> *readyList;
+};
+
+// Shortest job first, by (predicted) burst time.
+
+class SJFPolicy : public SortedPolicy {
+  public:
+    SJFPolicy();
+};
+
+// Shortest remaining time first: SJF, plus a preemption check on
+// every timer interrupt against the head of the ready list.
+
+class SRTFPolicy : public SortedPolicy {
+  public:
+    SRTFPolicy();
+
+    bool ShouldPreempt(Thread *current, bool idle);
+};
+
+// Static priorities (smaller runs first), aged by one for every timer
+// interrupt the current thread is charged, with priority inheritance
+// through locks (see Lock::Acquire).  Every timer interrupt ends the
+// time slice.
+
+class PriorityPolicy : public SortedPolicy {
+  public:
+    PriorityPolicy();
+
+    void OnTick(Thread *current, int slices, bool idle);
+    bool ShouldPreempt(Thread *current, bool idle) { return TRUE; }
+    void Donate(Thread *thread, int priority);
+    void Print();
+};
+
+// Multi-level feedback queue.  One FIFO queue per level, plus a
+// bitmap of the non-empty levels so that enqueue, dequeue and the
+// preemption check are all O(1).
+
+class MLFQPolicy : public SchedPolicy {
+  public:
+    MLFQPolicy();
+
+    void Enqueue(Thread *thread);
+    Thread *PickNext();
+    void OnTick(Thread *current, int slices, bool idle);
+    bool ShouldPreempt(Thread *current, bool idle);
+    void Print();
+
+  private:
+    std::list<Thread *> queue[MLFQLevels];
+    unsigned int mask;			// bit i set iff queue[i] non-empty
+    int epoch;				// incremented by every priority boost
+    int boostCountdown;			// timer interrupts until next boost
+    bool expired;			// current thread's quantum ran out
+					// on the last tick
+
+    void Refresh(Thread *thread);	// apply a pending boost to "thread"
+    void Boost();			// move every thread back to level 0
+};
+
+// Stride scheduling: ready threads in a min-heap on pass value.
+
+class StridePolicy : public SchedPolicy {
+  public:
+    StridePolicy();
+    ~StridePolicy() { delete heap; }
+
+    void Enqueue(Thread *thread);
+    Thread *PickNext();
+    void OnTick(Thread *current, int slices, bool idle);
+    bool ShouldPreempt(Thread *current, bool idle);
+    void OnBlock(Thread *thread) { Charge(thread); }
+    void OnDispatch(Thread *thread);
+    void SetTickets(Thread *thread, int tickets);
+    void Print();
+
+  private:
+    Heap<Thread *> *heap;
+    long long globalPass;		// pass of the last thread dispatched;
+					// threads that were away start here
+    long long dispatchedAt;		// when the running thread got the CPU
+					// (or was last charged)
+    int readySeq;			// orders threads with equal pass
+
+    void Charge(Thread *thread);	// bill the running thread for the
+					// CPU it used since dispatch
+};
+
+// Lottery scheduling: each time slice is a new weighted draw.
+
+class LotteryPolicy : public FIFOPolicy {
+  public:
+    LotteryPolicy() : FIFOPolicy("Lottery") { totalTickets = 0; }
+
+    void Enqueue(Thread *thread);
+    Thread *PickNext();
+    bool ShouldPreempt(Thread *current, bool idle)
+			{ return !idle && !readyList->IsEmpty(); }
+    void SetTickets(Thread *thread, int tickets);
+    void Print();
+
+  private:
+    int totalTickets;			// sum over the ready list
+};
+
+// Earliest deadline first: ready threads in a min-heap on deadline.
+// Threads that are not real-time have no deadline, and run in FIFO
+// order when no real-time thread is ready.  While a real-time thread
+// runs, an interrupt is scheduled for when its budget runs out; it
+// then has its deadline pushed back a period, with a fresh budget,
+// so that an overrunning thread cannot take time promised to others.
+
+class EDFPolicy : public SchedPolicy, public CallBackObj {
+  public:
+    EDFPolicy();
+    ~EDFPolicy();
+
+    void Enqueue(Thread *thread);
+    Thread *PickNext();
+    bool ShouldPreempt(Thread *current, bool idle);
+    void OnBlock(Thread *thread);
+    void OnDispatch(Thread *thread);
+    void OnFinish(Thread *thread);
+    bool Admit(Thread *thread, int period, int budget);
+    int EndJob(Thread *thread);
+    void Print();
+    void Report();
+
+    void CallBack();			// the running thread's budget ran out
+
+  private:
+    Heap<Thread *> *heap;
+    int readySeq;			// orders threads with equal deadline
+    double utilization;			// sum of budget / period, admitted
+					// threads that have not finished
+    int rejected;			// threads that failed admission
+    std::vector<RTTask *> tasks;	// every thread ever admitted
+    PendingInterrupt *budgetTimer;	// armed while a real-time thread
+					// runs; NULL otherwise
+    long long dispatchedAt;		// when the running thread got the CPU
+					// (or was last charged)
+
+    void Arm(Thread *thread);		// start and stop the budget timer
+    void Disarm();
+    void Charge(Thread *thread);	// take the CPU used since dispatch
+					// out of the thread's budget
+};
+
+#endif // SCHEDPOLICY_H
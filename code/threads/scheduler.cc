@@ -11,8 +11,9 @@
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	Which ready thread runs next, and when the running thread is
+//	preempted, is left to a SchedPolicy (see schedpolicy.h), picked
+//	by the SchedulerType the kernel was started with.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -22,75 +23,76 @@
 #include "debug.h"
 #include "scheduler.h"
 #include "main.h"
+#include "sysdep.h"
+#include <algorithm>
 
-//--------------------------------------------------------
-// 自定義函數，印出Thread的名稱及burstTime
-//--------------------------------------------------------
-void PrintThreadBurstTime(Thread *t) {
-    t->Print();
-    printf(" burstTime: %d    ",t->getBurstTime());
-}
-
-//----------------------------------------------------------------------
-// Compare function
-//----------------------------------------------------------------------
-int SJFCompare(Thread *a, Thread *b) {
-    if(a->getBurstTime() == b->getBurstTime())
-        return 0;
-    return a->getBurstTime() > b->getBurstTime() ? 1 : -1;
-}
-int PriorityCompare(Thread *a, Thread *b) {
-    if(a->getPriority() == b->getPriority())
-        return 0;
-    return a->getPriority() > b->getPriority() ? 1 : -1;
-}
-int FIFOCompare(Thread *a, Thread *b) {
-    return 1;
-}
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
 // 	Initialize the list of ready but not running threads.
-//	Initially, no ready threads.
+//	Initially, no ready threads.  Round robin unless "type" says
+//	otherwise.
 //----------------------------------------------------------------------
 
 Scheduler::Scheduler()
 {
-	Scheduler(RR);
-    DEBUG(dbgScheduler,"Schduler type: " << "RR");
+    Init(RR);
 }
 
 Scheduler::Scheduler(SchedulerType type)
+{
+    Init(type);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Init
+// 	The work of both constructors: pick the policy for "type", and
+//	start with no ready, finished or sleeping threads.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Init(SchedulerType type)
 {
 	schedulerType = type;
-    const char* schType;
 	switch(schedulerType) {
         case FIFO:
-		    readyList = new SortedList<Thread *>(FIFOCompare);
-            schType = "FIFO";
-		    break;
+            policy = new FIFOPolicy;
+            break;
         case SJF:
-		    readyList = new SortedList<Thread *>(SJFCompare);
-            schType = "SJF";
-        	break;
+            policy = new SJFPolicy;
+            break;
         case SRTF:
-            readyList = new SortedList<Thread *>(SJFCompare);
-            schType = "SRTF";
+            policy = new SRTFPolicy;
             break;
     	case RR:
-        	readyList = new List<Thread *>;
-            schType = "RR";
-        	break;
+            policy = new RRPolicy;
+            break;
     	case Priority:
-		    readyList = new SortedList<Thread *>(PriorityCompare);
-            schType = "Priority";
-        	break;
+            policy = new PriorityPolicy;
+            break;
+        case MLFQ:
+            policy = new MLFQPolicy;
+            break;
+        case Stride:
+            policy = new StridePolicy;
+            break;
+        case Lottery:
+            policy = new LotteryPolicy;
+            break;
+        case EDF:
+            policy = new EDFPolicy;
+            break;
    	}
-    DEBUG(dbgScheduler,"Schduler type: " << schType);
+    DEBUG(dbgScheduler,"Schduler type: " << policy->getName());
 	toBeDestroyed = NULL;
+    numReady = 0;
+    metricsFile = NULL;
 
     // for sleep list
-    sleepingList = std::vector<Sleeper>();
+    sleepSeq = 0;
     cpuInterrupt = 0;
+
+    burstAlpha = 0.0;			// no burst prediction
+    burstStart = 0;
 } 
 
 //----------------------------------------------------------------------
@@ -100,7 +102,7 @@ Scheduler::Scheduler(SchedulerType type)
 
 Scheduler::~Scheduler()
 { 
-    delete readyList; 
+    delete policy;
 } 
 
 //----------------------------------------------------------------------
@@ -109,6 +111,9 @@ Scheduler::~Scheduler()
 //	Put it on the ready list, for later scheduling onto the CPU.
 //
 //	"thread" is the thread to be put on the ready list.
+//
+//	If the timer was stretched because the current thread had the
+//	CPU to itself, time slicing starts again (see Alarm::CallBack).
 //----------------------------------------------------------------------
 
 void
@@ -117,8 +122,17 @@ Scheduler::ReadyToRun (Thread *thread)
     ASSERT(kernel->interrupt->getLevel() == IntOff);
     DEBUG(dbgThread, "Putting thread on ready list: " << thread->getName());
     
+    if (burstAlpha > 0.0) {
+	if (thread == kernel->currentThread) {
+	    BurstEnd(thread);		// yielding ends a CPU burst
+	} else if (thread->getPredictedBurst() < 0) {
+	    thread->setPredictedBurst(InitialBurstGuess(thread));
+	}
+    }
     thread->setStatus(READY);
-    readyList->Append(thread);
+    policy->Enqueue(thread);
+    numReady++;
+    kernel->alarm->Rearm();
 }
 
 //----------------------------------------------------------------------
@@ -134,17 +148,15 @@ Scheduler::FindNextToRun ()
 {
     ASSERT(kernel->interrupt->getLevel() == IntOff);
 
-    if (readyList->IsEmpty()) {
-	return NULL;
-    } else {
-        // 自定義debug flag，印出所有的thread的bursttime
-        if (debug->IsEnabled(dbgScheduler)) {
-	    printf("readyList: ");
-            readyList->Apply(PrintThreadBurstTime);
-            printf("\n");
-        }
-    	return readyList->RemoveFront();
+    // 自定義debug flag，印出所有的thread的bursttime
+    if (debug->IsEnabled(dbgScheduler)) {
+	Print();
     }
+    Thread *next = policy->PickNext();
+
+    if (next != NULL)
+	numReady--;
+    return next;
 }
 
 //----------------------------------------------------------------------
@@ -188,6 +200,15 @@ Scheduler::Run (Thread *nextThread, bool finishing)
     oldThread->CheckOverflow();		    // check if the old thread
 					    // had an undetected stack overflow
 
+    if (finishing)
+	policy->OnFinish(oldThread);
+    policy->OnDispatch(nextThread);
+    if (burstAlpha > 0.0) {
+	if (oldThread->getStatus() != READY)
+	    BurstEnd(oldThread);	// blocking or finishing
+	burstStart = kernel->stats->userTicks + kernel->stats->systemTicks;
+    }
+
     kernel->currentThread = nextThread;  // switch to the next thread
     nextThread->setStatus(RUNNING);      // nextThread is now running
     
@@ -244,8 +265,295 @@ Scheduler::CheckToBeDestroyed()
 void
 Scheduler::Print()
 {
-    cout << "Ready list contents:\n";
-    readyList->Apply(ThreadPrint);
+    cout << "Ready list contents (" << policy->getName() << "):\n";
+    policy->Print();
+    cout << "\n";
+}
+
+//----------------------------------------------------------------------
+// PrintSummary
+// 	Print the mean, median, 90th and 99th percentile (by nearest
+//	rank) and maximum of a set of measurements.  Sorts "v".
+//----------------------------------------------------------------------
+
+static void
+PrintSummary(char *what, std::vector<long long> &v)
+{
+    int n = v.size();
+    double sum = 0;
+
+    std::sort(v.begin(), v.end());
+    for (int i = 0; i < n; i++)
+	sum += v[i];
+    cout << what << ": mean " << sum / n;
+    cout << ", p50 " << v[(n * 50 + 99) / 100 - 1];
+    cout << ", p90 " << v[(n * 90 + 99) / 100 - 1];
+    cout << ", p99 " << v[(n * 99 + 99) / 100 - 1];
+    cout << ", max " << v[n - 1] << "\n";
+}
+
+//----------------------------------------------------------------------
+// Scheduler::PrintMetrics
+// 	Summarize the scheduling history of every thread that finished:
+//	waiting time (ticks on the ready list), turnaround time (creation
+//	to finish), response time (creation to first run), and the number
+//	of times each was switched to.  Threads still alive at halt,
+//	such as "main", are left out.  Called at halt, if nachos was run
+//	with -metrics; so is the policy's own report (SchedPolicy::Report).
+//
+//	If a metrics file was given, also write one CSV line per thread,
+//	in the order they finished.  "cpu_share" is the thread's running
+//	time as a fraction of all the ticks so far.
+//----------------------------------------------------------------------
+
+void
+Scheduler::PrintMetrics()
+{
+    int n = finished.size();
+    long long now = kernel->stats->totalTicks;
+    std::vector<long long> waiting(n), turnaround(n), response(n), switches(n);
+
+    policy->Report();
+    if (n == 0)
+	return;
+    for (int i = 0; i < n; i++) {
+	waiting[i] = finished[i].readyTicks;
+	turnaround[i] = finished[i].finished - finished[i].created;
+	response[i] = finished[i].firstRun - finished[i].created;
+	switches[i] = finished[i].switches;
+    }
+    cout << "Threads: finished " << n << "\n";
+    PrintSummary("Waiting ticks", waiting);
+    PrintSummary("Turnaround ticks", turnaround);
+    PrintSummary("Response ticks", response);
+    PrintSummary("Context switches", switches);
+
+    if (metricsFile != NULL) {
+	int fd = OpenForWrite(metricsFile);
+	char line[256];
+	int len;
+
+	len = sprintf(line, "thread,created,first_run,finished,waiting,"
+		"turnaround,response,running,blocked,switches,cpu_share\n");
+	WriteFile(fd, line, len);
+	for (int i = 0; i < n; i++) {
+	    ThreadMetrics *m = &finished[i];
+	    len = snprintf(line, sizeof(line),
+		"%s,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%d,%.4f\n",
+		m->name, m->created, m->firstRun, m->finished,
+		m->readyTicks, m->finished - m->created,
+		m->firstRun - m->created, m->runTicks, m->blockedTicks,
+		m->switches, now > 0 ? (double) m->runTicks / now : 0.0);
+	    WriteFile(fd, line, min(len, (int) sizeof(line) - 1));
+	}
+	Close(fd);
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Blocked
+// 	Called from Thread::Sleep when the current thread blocks or
+//	finishes, before looking for the next thread to run: the policy
+//	stops charging it now, rather than after any time the machine
+//	then spends idle.
+//
+//	A finishing thread's metrics are recorded here too: if it is
+//	the last thread, the machine halts while idle, and never gets
+//	as far as switching away from it.
+//
+//	"finishing" is set if the thread is finishing
+//----------------------------------------------------------------------
+
+void
+Scheduler::Blocked(Thread *thread, bool finishing)
+{
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    policy->OnBlock(thread);
+    if (finishing) {
+	thread->getMetrics()->finished = kernel->stats->totalTicks;
+	finished.push_back(*thread->getMetrics());
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Tick, Scheduler::ShouldPreempt
+// 	Called from the timer interrupt handler: let the policy charge
+//	the current thread for the time slice, then ask it whether the
+//	current thread should be preempted.
+//
+//	"slices" -- how many timer interrupts' worth of time has passed
+//	"idle" -- TRUE if the machine was idle, rather than running the
+//		current thread
+//----------------------------------------------------------------------
+
+void
+Scheduler::Tick(int slices, bool idle)
+{
+    policy->OnTick(kernel->currentThread, slices, idle);
+}
+
+bool
+Scheduler::ShouldPreempt(bool idle)
+{
+    return policy->ShouldPreempt(kernel->currentThread, idle);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SetTickets
+// 	Give "thread" a new number of tickets, clamped to 1..MaxTickets.
+//	CPU time already used is charged at the old rate.
+//----------------------------------------------------------------------
+
+void
+Scheduler::SetTickets(Thread *thread, int tickets)
+{
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    if (tickets < 1)
+	tickets = 1;
+    else if (tickets > MaxTickets)
+	tickets = MaxTickets;
+    DEBUG(dbgScheduler, "Thread " << thread->getName() << " now has " << tickets << " tickets");
+
+    policy->SetTickets(thread, tickets);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Donate
+// 	Set the priority "thread" inherits from the threads waiting on
+//	its locks.  The policy keeps its ready queue in order, if it
+//	sorts on priority.
+//
+//	"priority" -- the best priority among those waiters, or
+//		NoDonation
+//----------------------------------------------------------------------
+
+void
+Scheduler::Donate(Thread *thread, int priority)
+{
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    DEBUG(dbgScheduler, "Thread " << thread->getName() << " inherits priority " << priority);
+    policy->Donate(thread, priority);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SetRealTime
+// 	Ask the policy to run "thread" as a periodic real-time thread:
+//	one job of at most "budget" ticks of CPU every "period" ticks.
+//	Only EDF accepts; it refuses threads that would push the total
+//	utilization above 1.
+//
+//	Returns TRUE if the thread was admitted.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::SetRealTime(Thread *thread, int period, int budget)
+{
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+
+    return policy->Admit(thread, period, budget);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::EndJob
+// 	The current (real-time) thread has finished this period's job.
+//	Sleep until the next one is released (the policy wakes us up);
+//	if it is late and the next one is already out, keep going
+//	unless a thread with an earlier deadline is waiting.
+//----------------------------------------------------------------------
+
+void
+Scheduler::EndJob()
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    Thread *current = kernel->currentThread;
+    int wait = policy->EndJob(current);
+
+    if (wait > 0)
+	current->Sleep(FALSE);
+    else if (policy->ShouldPreempt(current, FALSE))
+	current->Yield();
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::setBurstAlpha
+// 	Turn on automatic CPU burst prediction.  The length of each burst
+//	(CPU time from dispatch until the thread yields or blocks) is
+//	measured, and the next one predicted as
+//		alpha * last burst + (1 - alpha) * last prediction
+//	SJF and SRTF then sort on the prediction instead of burstTime.
+//
+//	"alpha" -- weight of the most recent burst, in (0, 1]; 0 turns
+//		prediction off
+//----------------------------------------------------------------------
+
+void
+Scheduler::setBurstAlpha(double alpha)
+{
+    ASSERT(alpha >= 0.0 && alpha <= 1.0);
+    burstAlpha = alpha;
+    DEBUG(dbgScheduler, "Burst prediction alpha: " << alpha);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::InitialBurstGuess
+// 	The prediction to start a thread with: its hand-set burst time
+//	if it has one, otherwise one time slice.
+//----------------------------------------------------------------------
+
+int
+Scheduler::InitialBurstGuess(Thread *thread)
+{
+    return thread->getBurstTime() > 0 ? thread->getBurstTime() : TimerTicks;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::BurstEnd
+// 	The running thread is giving up the CPU: measure the burst it
+//	just finished, record how far off its prediction was, and
+//	predict the next one.
+//----------------------------------------------------------------------
+
+void
+Scheduler::BurstEnd(Thread *thread)
+{
+    Statistics *stats = kernel->stats;
+    int burst = stats->userTicks + stats->systemTicks - burstStart;
+    int predicted = thread->getPredictedBurst();
+
+    if (predicted < 0) {		// e.g. main, which was never readied
+	predicted = InitialBurstGuess(thread);
+    } else {
+	stats->numBursts++;
+	stats->burstTicks += burst;
+	stats->burstError += predicted - burst;
+	stats->burstAbsError += (predicted > burst) ? predicted - burst : burst - predicted;
+    }
+    thread->setPredictedBurst((int)(burstAlpha * burst + (1.0 - burstAlpha) * predicted + 0.5));
+    DEBUG(dbgScheduler, "Thread " << thread->getName() << " burst " << burst
+		<< ", predicted " << predicted << ", next " << thread->getPredictedBurst());
+    burstStart += burst;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::RemainingBurst
+// 	How much longer "thread" is expected to run before it blocks.
+//	For the running thread, under prediction, this is what is left of
+//	its predicted burst (never less than zero).
+//----------------------------------------------------------------------
+
+int
+Scheduler::RemainingBurst(Thread *thread)
+{
+    if (burstAlpha > 0.0 && thread == kernel->currentThread) {
+	int used = kernel->stats->userTicks + kernel->stats->systemTicks - burstStart;
+	int left = thread->getExpectedBurst() - used;
+	return left > 0 ? left : 0;
+    }
+    return thread->getExpectedBurst();
 }
 
 //----------------------------------------------------------------------
@@ -255,24 +563,25 @@ Scheduler::Print()
 //      
 //      若有，則將該thread放回ready queue，並且回傳True
 //
+//	The sleeping queue is a min-heap on the due time, so we only
+//	ever look at its top: the cost per timer interrupt is O(1) plus
+//	O(log n) for each thread actually woken.
+//
+//	"slices" -- how many timer interrupts' worth of time has passed;
+//		more than one when the timer skipped idle time slices
 //----------------------------------------------------------------------
-bool Scheduler::anyThreadWoken()
+bool Scheduler::anyThreadWoken(int slices)
 {
     bool woken = false;
-    cpuInterrupt++;
-    if (this->sleepingListEmpty()) return woken;
-    for(std::vector<Sleeper>::iterator it = sleepingList.begin(); it != sleepingList.end(); ) {
-        if(it->due <= this->cpuInterrupt) {
-            woken = true;
-            // 儲存起床的thread 指標
-            Thread * wokenThread = it->sleepTh;
-            cout << "sleepList::PutToReady Thread woken: " << wokenThread->getName() << endl;
-            // 將sleeper從 sleeping list remove，並且更新iter
-            it = sleepingList.erase(it);
-            // 將起床的thread送到readylist
-            this->ReadyToRun(wokenThread);
-        } 
-        else it++;
+    cpuInterrupt += slices;
+    while (!sleepingList.empty() && sleepingList.top().due <= cpuInterrupt) {
+        woken = true;
+        // 儲存起床的thread 指標
+        Thread * wokenThread = sleepingList.top().sleepTh;
+        DEBUG(dbgThread, "sleepList::PutToReady Thread woken: " << wokenThread->getName());
+        sleepingList.pop();
+        // 將起床的thread送到readylist
+        this->ReadyToRun(wokenThread);
     }
     return woken;
 }
@@ -289,6 +598,6 @@ bool Scheduler::anyThreadWoken()
 void Scheduler::PutToSleep(Thread * thread, int after)
 {
     ASSERT(kernel->interrupt->getLevel() == IntOff);// 檢查是否interrupt已經disabled
-    sleepingList.push_back(Sleeper(thread, cpuInterrupt + after));
+    sleepingList.push(Sleeper(thread, cpuInterrupt + after, sleepSeq++));
     thread->Sleep(FALSE);
 }
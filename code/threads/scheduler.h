@@ -12,7 +12,10 @@
 #include "copyright.h"
 #include "list.h"
 #include <vector>
+#include <list>
+#include <queue>
 #include "thread.h"
+#include "schedpolicy.h"
 
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
@@ -23,9 +26,39 @@ enum SchedulerType {
         SJF,
         Priority,
 		FIFO,
-		SRTF
+		SRTF,
+		MLFQ,	// Multi-level feedback queue
+		Stride,	// Proportional share, deterministic
+		Lottery,// Proportional share, randomized
+		EDF	// Earliest deadline first, real-time
 };
-class Sleeper;
+
+// A thread sleeping in Alarm::WaitUntil, and the timer interrupt count
+// at which it should be woken up.  "seq" breaks ties between sleepers
+// due at the same time, so they wake up in the order they went to sleep.
+
+class Sleeper {
+	public:
+		Sleeper(Thread *t, int when, int order):
+			sleepTh(t), due(when), seq(order){}
+		~Sleeper(){}
+		Thread * sleepTh;
+		int due;
+		int seq;
+};
+
+// Orders the sleeping queue as a min-heap on (due, seq).  
+// std::priority_queue keeps the *largest* element on top, hence ">".
+
+class SleeperCompare {
+	public:
+		bool operator()(const Sleeper &a, const Sleeper &b) const {
+			if (a.due != b.due)
+				return a.due > b.due;
+			return a.seq > b.seq;
+		}
+};
+
 class Scheduler {
   public:
 	Scheduler();		// Initialize list of ready threads 
@@ -41,37 +74,78 @@ class Scheduler {
 	void CheckToBeDestroyed();	// Check if thread that had been
     					// running needs to be deleted
 	void Print();			// Print contents of ready list
+	void PrintMetrics();		// summarize finished threads; called
+					// at halt, with -metrics
+	void setMetricsFile(char *name) {metricsFile = name;}
+					// also write them, one line per
+					// thread, to this CSV file
     	
-    void setSchedulerType(SchedulerType t) {schedulerType = t;}
 	SchedulerType getSchedulerType() {return schedulerType;}
 
     // SelfTest for scheduler is implemented in class Thread
     
-	bool anyThreadWoken();
-	bool sleepingListEmpty() { return sleepingList.size() == 0u; }//判斷是否 自定義 休眠型 wait queue 是否已經空了
+	void Blocked(Thread *thread, bool finishing);
+					// the current thread is giving up
+					// the CPU without becoming ready
+	void Tick(int slices, bool idle);// a timer interrupt went off
+	bool ShouldPreempt(bool idle);	// should the current thread give
+					// up the CPU?  Call after Tick
+
+	void setBurstAlpha(double alpha);// predict CPU bursts for SJF/SRTF
+	int RemainingBurst(Thread *thread);
+					// expected CPU time left in the
+					// thread's current burst
+
+	void SetTickets(Thread *thread, int tickets);
+					// change a thread's CPU share
+
+	void Donate(Thread *thread, int priority);
+					// change the priority "thread" has
+					// inherited, keeping the ready list
+					// in order (Priority only)
+
+	bool SetRealTime(Thread *thread, int period, int budget);
+					// make "thread" periodic, if the
+					// admission test passes (EDF only)
+	void EndJob();			// current thread is done for this
+					// period; sleep until the next
+
+	bool anyThreadWoken(int slices = 1);
+	bool sleepingListEmpty() { return sleepingList.empty(); }//判斷是否 自定義 休眠型 wait queue 是否已經空了
+	bool readyListEmpty() { return numReady == 0; }
+					// is no thread waiting for the CPU?
+	int nextWakeUp() { return sleepingList.top().due - cpuInterrupt; }
+					// timer interrupts until the first
+					// sleeper is due; list must not be empty
 	void PutToSleep(Thread * thread, int after);
 
   private:
+	void Init(SchedulerType type);	// shared by the constructors
+
 	SchedulerType schedulerType;
-	List<Thread *> *readyList;	// queue of threads that are ready to run,
-					// but not running
+	SchedPolicy *policy;		// keeps the threads that are ready
+					// to run, but not running
 
 	Thread *toBeDestroyed;		// finishing thread to be destroyed
     					// by the next thread that runs
+	int numReady;			// threads the policy holds
+
+	std::vector<ThreadMetrics> finished;
+					// history of every finished thread
+	char *metricsFile;		// CSV for PrintMetrics, or NULL
+
+	double burstAlpha;		// burst prediction weight; 0 if off
+	long long burstStart;		// user+system ticks at last dispatch
+	void BurstEnd(Thread *thread);	// measure and predict a CPU burst
+	int InitialBurstGuess(Thread *thread);
 
 	
-	std::vector<Sleeper> sleepingList;
+	// sleeping threads, as a min-heap on due time: each timer
+	// interrupt only looks at the top, and pops the threads it wakes
+	std::priority_queue<Sleeper, std::vector<Sleeper>, SleeperCompare> sleepingList;
+	int sleepSeq;			// next Sleeper::seq to hand out
 	int cpuInterrupt;
 	
 
 };
-class Sleeper {
-	public:
-		Sleeper(Thread *t, int when):
-			sleepTh(t), due(when){}
-		~Sleeper(){}
-		Thread * sleepTh;
-		int due;
-};
-	
 #endif // SCHEDULER_H
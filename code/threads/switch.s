@@ -11,6 +11,7 @@
  *	    SUN SPARC (SPARC)
  *	    HP PA-RISC (PARISC)
  *	    Intel 386 (x86)
+ *	    AMD64 / Intel 64 (X86_64)
  *	    IBM RS6000 (PowerPC) -- I hope it will also work for Mac PowerPC
  *
  * We define two routines for each architecture:
@@ -371,6 +372,67 @@ SWITCH:
 #endif // x86
 
 
+#ifdef X86_64
+
+        .text
+        .align  16
+
+/* void ThreadRoot( void )
+**
+** expects the following registers to be initialized:
+**      r15     points to startup function (interrupt enable)
+**      r13     contains inital argument to thread function
+**      r12     points to thread function
+**      r14     point to Thread::Finish()
+** All four are callee-saved, so they survive the calls below.
+*/
+        .globl  ThreadRoot
+ThreadRoot:
+        xorq    %rbp,%rbp               # end of the frame chain, for gdb
+        andq    $-16,%rsp               # calls need a 16-byte aligned stack
+        call    *StartupPC
+        movq    InitialArg,%rdi
+        call    *InitialPC
+        call    *WhenDonePC
+
+        # NOT REACHED
+        hlt
+
+
+/* void SWITCH( thread *t1, thread *t2 )
+**
+** on entry, rdi is t1, rsi is t2, and (rsp) is the return address.
+** We pop the return address into t1's saved pc, so that t1's saved
+** rsp is what it will be after SWITCH returns, and resume t2 by
+** jumping to its saved pc.  A thread that has never run "returns"
+** into ThreadRoot this way.
+*/
+        .globl  SWITCH
+SWITCH:
+        popq    %rax                    # return address
+        movq    %rax,_PC(%rdi)
+        movq    %rsp,_RSP(%rdi)         # save stack pointer
+        movq    %rbx,_RBX(%rdi)         # save callee-saved registers
+        movq    %rbp,_RBP(%rdi)
+        movq    %r12,_R12(%rdi)
+        movq    %r13,_R13(%rdi)
+        movq    %r14,_R14(%rdi)
+        movq    %r15,_R15(%rdi)
+
+        movq    _RSP(%rsi),%rsp         # restore stack pointer
+        movq    _RBX(%rsi),%rbx         # restore callee-saved registers
+        movq    _RBP(%rsi),%rbp
+        movq    _R12(%rsi),%r12
+        movq    _R13(%rsi),%r13
+        movq    _R14(%rsi),%r14
+        movq    _R15(%rsi),%r15
+        jmp     *_PC(%rsi)              # resume t2
+
+        .section .note.GNU-stack,"",@progbits
+
+#endif // X86_64
+
+
 
 #ifdef PowerPC
                 .globl branch[ds]
@@ -35,6 +35,21 @@
 #include "copyright.h"
 #include "synch.h"
 #include "main.h"
+#include "synchprof.h"
+
+//----------------------------------------------------------------------
+// ProfileFor
+// 	The contention statistics for an object of "kind" called "name",
+//	or NULL if profiling is off.
+//----------------------------------------------------------------------
+
+static SynchProfile *
+ProfileFor(const char *kind, char *name)
+{
+    if (kernel == NULL || kernel->synchProfiler == NULL)
+	return NULL;
+    return kernel->synchProfiler->Find(kind, name);
+}
 
 //----------------------------------------------------------------------
 // Semaphore::Semaphore
@@ -42,13 +57,15 @@
 //
 //	"debugName" is an arbitrary name, useful for debugging.
 //	"initialValue" is the initial value of the semaphore.
+//	"profiled" is FALSE if contention should not be recorded
 //----------------------------------------------------------------------
 
-Semaphore::Semaphore(char* debugName, int initialValue)
+Semaphore::Semaphore(char* debugName, int initialValue, bool profiled)
 {
     name = debugName;
     value = initialValue;
     queue = new List<Thread *>;
+    profile = profiled ? ProfileFor("Semaphore", debugName) : NULL;
 }
 
 //----------------------------------------------------------------------
@@ -85,12 +102,20 @@ Semaphore::P()
     
     // disable interrupts
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	
+    bool contended = (value == 0);
+    long long since = (profile != NULL && contended) ? profile->StartWait() : 0;
     
     while (value == 0) { 		// semaphore not available
 	queue->Append(currentThread);	// so go to sleep
 	currentThread->Sleep(FALSE);
     } 
     value--; 			// semaphore available, consume its value
+    if (profile != NULL) {
+	if (contended)
+	    profile->EndWait(since);
+	else
+	    profile->Acquired();
+    }
    
     // re-enable interrupts
     (void) interrupt->SetLevel(oldLevel);	
@@ -102,6 +127,11 @@ Semaphore::P()
 //	As with P(), this operation must be atomic, so we need to disable
 //	interrupts.  Scheduler::ReadyToRun() assumes that interrupts
 //	are disabled when it is called.
+//
+//	Under the Priority scheduler the waiter woken up is the most
+//	urgent one, not the first to wait (see NextWaiter): a lock, in
+//	particular, goes to the thread whose priority its holder was
+//	running with.
 //----------------------------------------------------------------------
 
 void
@@ -113,7 +143,7 @@ Semaphore::V()
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	
     
     if (!queue->IsEmpty()) {  // make thread ready.
-	kernel->scheduler->ReadyToRun(queue->RemoveFront());
+	kernel->scheduler->ReadyToRun(NextWaiter());
     }
     value++;
     
@@ -121,6 +151,31 @@ Semaphore::V()
     (void) interrupt->SetLevel(oldLevel);
 }
 
+//----------------------------------------------------------------------
+// Semaphore::NextWaiter
+// 	Take the thread to wake up off the queue: the first to wait, or,
+//	under the Priority scheduler, the first of the most urgent.
+//	Priorities change while threads wait (see Lock::PassOn), so the
+//	queue is searched here rather than kept sorted.
+//----------------------------------------------------------------------
+
+Thread *
+Semaphore::NextWaiter()
+{
+    Thread *best = queue->Front();
+
+    if (kernel->scheduler->getSchedulerType() == Priority) {
+	ListIterator<Thread *> iter(queue);
+
+	for (; !iter.IsDone(); iter.Next()) {
+	    if (iter.Item()->getPriority() < best->getPriority())
+		best = iter.Item();	// smaller runs first
+	}
+    }
+    queue->Remove(best);
+    return best;
+}
+
 //----------------------------------------------------------------------
 // Semaphore::SelfTest, SelfTestHelper
 // 	Test the semaphore implementation, by using a semaphore
@@ -163,8 +218,12 @@ Semaphore::SelfTest()
 Lock::Lock(char* debugName)
 {
     name = debugName;
-    semaphore = new Semaphore("lock", 1);  // initially, unlocked
+    semaphore = new Semaphore("lock", 1, FALSE);  // initially, unlocked
+    profile = ProfileFor("Lock", debugName);
+    acquiredAt = 0;
     lockHolder = NULL;
+    waiters = new List<Thread *>;
+    nextHeld = NULL;
 }
 
 //----------------------------------------------------------------------
@@ -174,6 +233,7 @@ Lock::Lock(char* debugName)
 Lock::~Lock()
 {
     delete semaphore;
+    delete waiters;
 }
 
 char*
@@ -186,15 +246,49 @@ Lock::getName()
 //	Atomically wait until the lock is free, then set it to busy.
 //	Equivalent to Semaphore::P(), with the semaphore value of 0
 //	equal to busy, and semaphore value of 1 equal to free.
+//
+//	Under the Priority scheduler, a thread that has to wait lends
+//	its priority to the lock holder (see Lock::PassOn), so that
+//	threads of middling priority cannot keep the holder, and with
+//	it the waiter, off the CPU.
 //----------------------------------------------------------------------
 
 void Lock::Acquire()
 {
+    Thread *currentThread = kernel->currentThread;
+    bool inherit = (kernel->scheduler->getSchedulerType() == Priority);
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    bool contended = (lockHolder != NULL);
+    long long since = (profile != NULL && contended) ? profile->StartWait() : 0;
+
     if (lockHolder != NULL) {
         DEBUG(dbgPage, lockHolder->getName() << " is using Disk, sleep currentTHread" << kernel->currentThread->getName())
+        if (inherit) {
+            waiters->Append(currentThread);
+            currentThread->setWaitingOn(this);
+            PassOn(currentThread->getPriority());
+        }
     }
     semaphore->P();
-    lockHolder = kernel->currentThread;
+    if (currentThread->getWaitingOn() == this) {
+        waiters->Remove(currentThread);
+        currentThread->setWaitingOn(NULL);
+    }
+    lockHolder = currentThread;
+    if (profile != NULL) {
+        if (contended)
+            profile->EndWait(since);
+        else
+            profile->Acquired();
+        acquiredAt = kernel->stats->totalTicks;
+    }
+    nextHeld = currentThread->getHeldLocks();
+    currentThread->setHeldLocks(this);
+    if (inherit && !waiters->IsEmpty()) {
+        // someone else got in ahead of a waiter; we owe it now
+        kernel->scheduler->Donate(currentThread, Inherited(currentThread));
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
@@ -205,16 +299,102 @@ void Lock::Acquire()
 //	equal to busy, and semaphore value of 1 equal to free.
 //
 //	By convention, only the thread that acquired the lock
-// 	may release it.
+// 	may release it.  Any priority it inherited through this lock
+//	is given back; what it inherited through locks it still holds
+//	is kept.
 //---------------------------------------------------------------------
 
 void Lock::Release()
 {
+    Thread *currentThread = kernel->currentThread;
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    Lock *prev = NULL;
+    Lock *l;
+
     ASSERT(IsHeldByCurrentThread());
     DEBUG(dbgPage,"Thread " << lockHolder->getName() << " finish using Disk and put to readyList")
     DEBUG(dbgThread,"Thread " << lockHolder->getName() << " finish using Disk and put to readyList")
+    for (l = currentThread->getHeldLocks(); l != this; l = l->nextHeld) {
+        ASSERT(l != NULL);
+        prev = l;
+    }
+    if (prev == NULL) {
+        currentThread->setHeldLocks(nextHeld);
+    } else {
+        prev->nextHeld = nextHeld;
+    }
+    nextHeld = NULL;
     lockHolder = NULL;
+    if (profile != NULL) {
+        profile->Held(kernel->stats->totalTicks - acquiredAt);
+    }
+    if (kernel->scheduler->getSchedulerType() == Priority) {
+        kernel->scheduler->Donate(currentThread, Inherited(currentThread));
+    }
     semaphore->V();
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Lock::PassOn
+//	Raise the lock holder to "priority", if it is not already at
+//	least that urgent.  If the holder is itself waiting for a lock,
+//	pass the priority on to that lock's holder, and so on down the
+//	chain.  Stops early once a holder needs no raising, so a
+//	deadlock cycle cannot make it loop forever.
+//
+//	"priority" -- the priority of a thread about to wait on us
+//----------------------------------------------------------------------
+
+void
+Lock::PassOn(int priority)
+{
+    Lock *lock = this;
+
+    while (lock != NULL && lock->lockHolder != NULL) {
+        Thread *holder = lock->lockHolder;
+
+        if (holder->getPriority() <= priority) {
+            break;			// smaller runs first
+        }
+        kernel->scheduler->Donate(holder, priority);
+        lock = holder->getWaitingOn();
+    }
+}
+
+//----------------------------------------------------------------------
+// Lock::BestWaiter
+//	Return the best (smallest) priority of any thread waiting
+//	for this lock, or NoDonation if there are none.
+//----------------------------------------------------------------------
+
+int
+Lock::BestWaiter()
+{
+    ListIterator<Thread *> iter(waiters);
+    int best = NoDonation;
+
+    for (; !iter.IsDone(); iter.Next()) {
+        best = min(best, iter.Item()->getPriority());
+    }
+    return best;
+}
+
+//----------------------------------------------------------------------
+// Lock::Inherited
+//	Return the priority "thread" should inherit: the best priority
+//	waiting on any of the locks it holds, or NoDonation.
+//----------------------------------------------------------------------
+
+int
+Lock::Inherited(Thread *thread)
+{
+    int best = NoDonation;
+
+    for (Lock *l = thread->getHeldLocks(); l != NULL; l = l->nextHeld) {
+        best = min(best, l->BestWaiter());
+    }
+    return best;
 }
 
 bool
@@ -222,6 +402,362 @@ Lock::IsHeldByCurrentThread()
 {
 	return lockHolder == kernel->currentThread;
 }
+
+//----------------------------------------------------------------------
+// Lock::SelfTest, LockTestHelper, ChainTestHelper
+// 	Test priority inheritance; only the Priority scheduler has it.
+//
+//	First, while we hold the lock at a low priority, a low priority
+//	thread starts waiting for it, and then a high priority one.  Each
+//	must lend us its priority as it starts waiting; once we release
+//	the lock we must be back at our own priority, and the high
+//	priority thread must get the lock first.
+//
+//	Then a chain: we hold the lock, "B" holds a second lock and waits
+//	for ours, and "A" waits for B's.  A's priority must reach us
+//	through B, and each of us must give it back on releasing the
+//	lock it was lent for.
+//----------------------------------------------------------------------
+
+static Lock *testLock, *chainLock;
+static char *gotLock[2];
+static int numGot;
+static bool chainRestored;		// B back at its own priority after
+					// releasing chainLock?
+
+static void
+LockTestHelper(char *name)
+{
+    testLock->Acquire();
+    gotLock[numGot++] = name;
+    testLock->Release();
+}
+
+//	The threads may be time sliced before they get to wait, so we
+//	yield until they have.
+
+static void
+YieldUntilBlocked(Thread *thread)
+{
+    while (thread->getStatus() != BLOCKED)
+	kernel->currentThread->Yield();
+}
+
+static void
+ChainTestHelper(char *name)
+{
+    chainLock->Acquire();
+    if (strcmp(name, "B") == 0) {
+	testLock->Acquire();		// held by the test; we wait
+	testLock->Release();
+	chainLock->Release();
+	chainRestored = (kernel->currentThread->getPriority()
+			 == kernel->currentThread->getBasePriority());
+    } else {
+	chainLock->Release();
+    }
+    numGot++;
+}
+
+void
+Lock::SelfTest()
+{
+    Thread *self = kernel->currentThread;
+    Thread *low, *high, *a, *b;
+    int oldPriority = self->getPriority();
+
+    if (kernel->scheduler->getSchedulerType() != Priority) {
+	printf("Lock::SelfTest: skipped, priority inheritance needs "
+		"-PRIORITY\n");
+	return;
+    }
+    low = new Thread("low");
+    high = new Thread("high");
+    a = new Thread("A");
+    b = new Thread("B");
+    testLock = this;
+    numGot = 0;
+    Acquire();
+    self->setPriority(9);		// less urgent than any other thread
+    low->setPriority(5);
+    low->Fork((VoidFunctionPtr) LockTestHelper, (void *) "low");
+    YieldUntilBlocked(low);		// low waits, lending us 5
+    ASSERT(self->getPriority() == low->getPriority());
+    high->setPriority(1);
+    high->Fork((VoidFunctionPtr) LockTestHelper, (void *) "high");
+    YieldUntilBlocked(high);		// high waits, lending us 1
+    ASSERT(self->getPriority() == high->getPriority());
+    Release();
+    ASSERT(self->getPriority() == self->getBasePriority());
+    while (numGot < 2)
+	self->Yield();
+    printf("Lock::SelfTest: %s got the lock first, then %s\n",
+	gotLock[0], gotLock[1]);
+    ASSERT(strcmp(gotLock[0], "high") == 0);
+
+    chainLock = new Lock("chain");
+    numGot = 0;
+    Acquire();
+    self->setPriority(9);		// the Priority policy ages us as
+					// we run; start over
+    b->setPriority(7);
+    b->Fork((VoidFunctionPtr) ChainTestHelper, (void *) "B");
+    YieldUntilBlocked(b);		// B takes chainLock, waits for us
+    ASSERT(self->getPriority() == b->getPriority());
+    a->setPriority(3);
+    a->Fork((VoidFunctionPtr) ChainTestHelper, (void *) "A");
+    YieldUntilBlocked(a);		// A waits for B, and so for us
+    printf("Lock::SelfTest: A at %d waits for B at %d, waiting for "
+	"main at %d\n", a->getPriority(), b->getPriority(),
+	self->getPriority());
+    ASSERT(b->getPriority() == a->getPriority()
+	   && self->getPriority() == a->getPriority());
+    Release();
+    ASSERT(self->getPriority() == self->getBasePriority());
+    while (numGot < 2)
+	self->Yield();
+    ASSERT(chainRestored);
+    delete chainLock;
+    self->setPriority(oldPriority);
+}
+
+//----------------------------------------------------------------------
+// FastLock::FastLock, FastLock::~FastLock
+// 	Initialize a lock, so that it can be used for synchronization;
+//	de-allocate it when no longer needed.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+FastLock::FastLock(char* debugName)
+{
+    name = debugName;
+    lockHolder = NULL;
+    waiters = new List<Thread *>;
+    profile = ProfileFor("FastLock", debugName);
+    acquiredAt = 0;
+}
+
+FastLock::~FastLock()
+{
+    ASSERT(waiters->IsEmpty());
+    delete waiters;
+}
+
+//----------------------------------------------------------------------
+// FastLock::Acquire
+//	Take the lock if it is free, without touching the interrupt
+//	level; otherwise wait for the holder to hand it to us.
+//----------------------------------------------------------------------
+
+void
+FastLock::Acquire()
+{
+    Thread *currentThread = kernel->currentThread;
+
+    ASSERT(lockHolder != currentThread);
+    if (lockHolder == NULL) {		// fast path
+	lockHolder = currentThread;
+	if (profile != NULL) {
+	    profile->Acquired();
+	    acquiredAt = kernel->stats->totalTicks;
+	}
+	return;
+    }
+
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    long long since = (profile != NULL) ? profile->StartWait() : 0;
+
+    waiters->Append(currentThread);
+    currentThread->Sleep(FALSE);
+    ASSERT(lockHolder == currentThread);	// handed to us
+    if (profile != NULL) {
+	profile->EndWait(since);
+	acquiredAt = kernel->stats->totalTicks;
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// FastLock::Release
+//	Free the lock, or hand it to the thread that has waited longest.
+//----------------------------------------------------------------------
+
+void
+FastLock::Release()
+{
+    ASSERT(IsHeldByCurrentThread());
+    if (profile != NULL)
+	profile->Held(kernel->stats->totalTicks - acquiredAt);
+    if (waiters->IsEmpty()) {		// fast path
+	lockHolder = NULL;
+	return;
+    }
+
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    lockHolder = waiters->RemoveFront();
+    kernel->scheduler->ReadyToRun(lockHolder);
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+bool
+FastLock::IsHeldByCurrentThread()
+{
+    return lockHolder == kernel->currentThread;
+}
+
+//----------------------------------------------------------------------
+// RWLock::RWLock, RWLock::~RWLock
+// 	Initialize a readers-writer lock; de-allocate it when no longer
+//	needed.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+RWLock::RWLock(char* debugName)
+{
+    name = debugName;
+    readers = 0;
+    writer = NULL;
+    waitingReaders = new List<Thread *>;
+    waitingWriters = new List<Thread *>;
+    profile = ProfileFor("RWLock", debugName);
+    acquiredAt = 0;
+}
+
+RWLock::~RWLock()
+{
+    ASSERT(waitingReaders->IsEmpty() && waitingWriters->IsEmpty());
+    delete waitingReaders;
+    delete waitingWriters;
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireRead
+//	Get shared access.  Wait if a writer holds the lock or is
+//	waiting for it; the writer that releases it next lets us in.
+//----------------------------------------------------------------------
+
+void
+RWLock::AcquireRead()
+{
+    Thread *currentThread = kernel->currentThread;
+
+    if (writer == NULL && waitingWriters->IsEmpty()) {	// fast path
+	readers++;
+	if (profile != NULL)
+	    profile->Acquired();
+	return;
+    }
+
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    long long since = (profile != NULL) ? profile->StartWait() : 0;
+
+    DEBUG(dbgThread, currentThread->getName() << " waits to read " << name);
+    waitingReaders->Append(currentThread);
+    currentThread->Sleep(FALSE);	// counted in "readers" by whoever
+					// woke us up
+    if (profile != NULL)
+	profile->EndWait(since);
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseRead
+//	Give up shared access.  The last reader out hands the lock to
+//	the first waiting writer, if any.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReleaseRead()
+{
+    ASSERT(readers > 0 && writer == NULL);
+    if (--readers > 0 || waitingWriters->IsEmpty()) {	// fast path
+	return;
+    }
+
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    writer = waitingWriters->RemoveFront();
+    kernel->scheduler->ReadyToRun(writer);
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireWrite
+//	Get exclusive access, waiting for the readers or the writer
+//	holding the lock, and for the writers already waiting.
+//----------------------------------------------------------------------
+
+void
+RWLock::AcquireWrite()
+{
+    Thread *currentThread = kernel->currentThread;
+
+    ASSERT(writer != currentThread);
+    if (writer == NULL && readers == 0) {	// fast path; nobody can be
+	writer = currentThread;			// waiting on a free lock
+	if (profile != NULL) {
+	    profile->Acquired();
+	    acquiredAt = kernel->stats->totalTicks;
+	}
+	return;
+    }
+
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    long long since = (profile != NULL) ? profile->StartWait() : 0;
+
+    DEBUG(dbgThread, currentThread->getName() << " waits to write " << name);
+    waitingWriters->Append(currentThread);
+    currentThread->Sleep(FALSE);
+    ASSERT(writer == currentThread);	// handed to us
+    if (profile != NULL) {
+	profile->EndWait(since);
+	acquiredAt = kernel->stats->totalTicks;
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseWrite
+//	Give up exclusive access.  Admit every waiting reader as one
+//	batch if there are any; otherwise hand the lock to the next
+//	writer.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReleaseWrite()
+{
+    ASSERT(IsWriteHeldByCurrentThread());
+    if (profile != NULL)
+	profile->Held(kernel->stats->totalTicks - acquiredAt);
+    if (waitingReaders->IsEmpty() && waitingWriters->IsEmpty()) {
+	writer = NULL;			// fast path
+	return;
+    }
+
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    if (!waitingReaders->IsEmpty()) {
+	writer = NULL;
+	while (!waitingReaders->IsEmpty()) {
+	    readers++;
+	    kernel->scheduler->ReadyToRun(waitingReaders->RemoveFront());
+	}
+    } else {
+	writer = waitingWriters->RemoveFront();
+	kernel->scheduler->ReadyToRun(writer);
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+bool
+RWLock::IsWriteHeldByCurrentThread()
+{
+    return writer == kernel->currentThread;
+}
+
 //----------------------------------------------------------------------
 // Condition::Condition
 // 	Initialize a condition variable, so that it can be 
@@ -234,6 +770,7 @@ Condition::Condition(char* debugName)
 {
     name = debugName;
     waitQueue = new List<Semaphore *>;
+    profile = ProfileFor("Condition", debugName);
 }
 
 //----------------------------------------------------------------------
@@ -272,10 +809,13 @@ void Condition::Wait(Lock* conditionLock)
     
      ASSERT(conditionLock->IsHeldByCurrentThread());
 
-     waiter = new Semaphore("condition", 0);
+     waiter = new Semaphore("condition", 0, FALSE);
      waitQueue->Append(waiter);
+     long long since = (profile != NULL) ? profile->StartWait() : 0;
      conditionLock->Release();
      waiter->P();
+     if (profile != NULL)
+	 profile->EndWait(since);	// the lock is profiled on its own
      conditionLock->Acquire();
      delete waiter;
 }
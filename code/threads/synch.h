@@ -7,6 +7,10 @@
 //	interface is given -- they are to be implemented as part of 
 //	the first assignment.
 //
+//	Two variants of the lock are also defined: FastLock, which
+//	skips the semaphore when the lock is free, and RWLock, which
+//	lets readers share the lock.
+//
 //	Note that all the synchronization objects take a "name" as
 //	part of the initialization.  This is solely for debugging purposes.
 //
@@ -22,6 +26,8 @@
 #include "list.h"
 #include "main.h"
 
+class SynchProfile;
+
 // The following class defines a "semaphore" whose value is a non-negative
 // integer.  The semaphore has only two operations P() and V():
 //
@@ -39,7 +45,10 @@
 
 class Semaphore {
   public:
-    Semaphore(char* debugName, int initialValue);	// set initial value
+    Semaphore(char* debugName, int initialValue, bool profiled = TRUE);
+    					// set initial value; "profiled" is
+					// FALSE for semaphores inside other
+					// objects, which profile themselves
     ~Semaphore();   					// de-allocate semaphore
     char* getName();			// debugging assist
     
@@ -52,6 +61,9 @@ class Semaphore {
     int value;         // semaphore value, always >= 0
     List<Thread *> *queue;     
 		  	// threads waiting in P() for the value to be > 0
+    SynchProfile *profile;	// contention statistics, or NULL
+
+    Thread *NextWaiter();	// remove the waiter V should wake up
    };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -78,13 +90,94 @@ class Lock {
     bool IsHeldByCurrentThread(); 
     				// return true if the current thread 
 				// holds this lock.
+    void SelfTest();		// test priority inheritance, and that
+    				// a released lock goes to the most
+    				// urgent waiter (Priority only)
     
-    // Note: SelfTest routine provided by SynchList
+    // Note: other SelfTest routine provided by SynchList
     
   private:
     char *name;			// debugging assist
     Thread *lockHolder;		// thread currently holding lock
     Semaphore *semaphore;	// we use a semaphore to implement lock
+    SynchProfile *profile;	// contention statistics, or NULL
+    long long acquiredAt;	// when lockHolder got the lock
+
+    // Priority inheritance, under the Priority scheduler only
+    List<Thread *> *waiters;	// threads blocked in Acquire
+    Lock *nextHeld;		// next lock held by lockHolder
+
+    void PassOn(int priority);	// donate to the holder, and to whoever
+    				// holds the lock it is waiting on, ...
+    int BestWaiter();		// best priority among waiters
+    static int Inherited(Thread *thread);
+    				// best priority waiting on any lock
+				// "thread" holds
+};
+
+// A lock with a fast path: Acquire and Release of a free lock are a
+// test and a store, with no semaphore and no change to the interrupt
+// level.  Only when the lock is busy does Acquire disable interrupts
+// and sleep; Release then hands the lock straight to the first
+// waiter.
+//
+// The fast path is atomic because Nachos only switches threads inside
+// Interrupt routines (when interrupts are re-enabled, or the clock
+// advances), and none is called between the test and the store.
+// Unlike Lock, a FastLock does no priority inheritance; it also does
+// not advance the simulated clock, since it never re-enables
+// interrupts on the fast path.
+
+class FastLock {
+  public:
+    FastLock(char* debugName);		// initialize lock to be FREE
+    ~FastLock();			// deallocate lock
+    char* getName() { return name; }	// debugging assist
+
+    void Acquire();
+    void Release();
+    bool IsHeldByCurrentThread();
+
+  private:
+    char *name;				// debugging assist
+    Thread *lockHolder;			// NULL if the lock is FREE
+    List<Thread *> *waiters;		// threads blocked in Acquire
+    SynchProfile *profile;		// contention statistics, or NULL
+    long long acquiredAt;		// when lockHolder got the lock
+};
+
+// A readers-writer lock: any number of readers, or one writer.
+//
+// Writers are preferred: once a writer is waiting, new readers wait
+// too, so a steady stream of readers cannot starve it.  Readers are
+// admitted in batches: when a writer releases the lock, every reader
+// waiting at that moment gets in together, ahead of any other waiting
+// writer, so that writers cannot starve readers either.  The lock is
+// handed directly to the threads woken up.
+//
+// Uncontended acquires and releases take the same fast path as
+// FastLock.
+
+class RWLock {
+  public:
+    RWLock(char* debugName);		// initialize lock to be FREE
+    ~RWLock();				// deallocate lock
+    char* getName() { return name; }	// debugging assist
+
+    void AcquireRead();			// shared
+    void ReleaseRead();
+    void AcquireWrite();		// exclusive
+    void ReleaseWrite();
+    bool IsWriteHeldByCurrentThread();
+
+  private:
+    char *name;				// debugging assist
+    int readers;			// readers holding the lock
+    Thread *writer;			// writer holding the lock, or NULL
+    List<Thread *> *waitingReaders;	// the next batch of readers
+    List<Thread *> *waitingWriters;
+    SynchProfile *profile;		// contention statistics, or NULL
+    long long acquiredAt;		// when the writer got the lock
 };
 
 // The following class defines a "condition variable".  A condition
@@ -139,5 +232,6 @@ class Condition {
   private:
     char* name;
     List<Semaphore *> *waitQueue;	// list of waiting threads
+    SynchProfile *profile;		// wait statistics, or NULL
 };
 #endif // SYNCH_H
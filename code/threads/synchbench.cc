@@ -0,0 +1,353 @@
+// synchbench.cc
+//	Micro-benchmarks for the primitives everything else in the
+//	kernel is built on: Fork/Finish, Yield, semaphores, locks,
+//	condition variables, readers-writer locks and synchronized
+//	lists.
+//
+//	Each benchmark forks whatever helper threads it needs, runs a
+//	fixed number of operations, waits for the helpers to finish, and
+//	reports both the host time it took (wall clock, in nanoseconds)
+//	and the simulated time (in ticks).  The output is CSV, one line
+//	per benchmark, with the columns
+//
+//	    benchmark,threads,ops,host_ns,host_ns_per_op,ticks,ticks_per_op
+//
+//	"threads" counts the helper threads; "ops" is the number of
+//	operations the per-op columns are divided by (see each routine).
+//	Benchmark names and column order are fixed, so that results from
+//	different builds can be compared line by line.
+//
+//	The numbers are meant for the default (round robin) scheduler;
+//	other schedulers run the same work, but may interleave it
+//	differently.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "synchbench.h"
+#include "main.h"
+#include "synch.h"
+#include "synchlist.h"
+#include "sysdep.h"
+
+const int BenchLockers = 4;		// threads fighting over the lock
+const int BenchWaiters = 8;		// threads waiting on the condition
+
+// State shared between a benchmark and its helper threads.
+static int benchOps;			// operations per helper
+static int benchDone;			// helpers that have finished
+static Semaphore *benchPing, *benchPong;
+static Lock *benchLock;
+static FastLock *benchFastLock;
+static RWLock *benchRWLock;
+static Condition *benchCond;
+static int benchRound;			// broadcasts sent so far
+static int benchWaits;			// waits started so far
+static SynchList<int> *benchList;
+
+static long long hostStart;		// when the current benchmark started
+static long long tickStart;
+
+//----------------------------------------------------------------------
+// BenchStart, BenchReport
+// 	Start the clocks for a benchmark, and print its CSV line.
+//
+//	"name" is the benchmark name
+//	"threads" is the number of helper threads it used
+//	"ops" is the number of operations it performed
+//----------------------------------------------------------------------
+
+static void
+BenchStart()
+{
+    benchDone = 0;
+    tickStart = kernel->stats->totalTicks;
+    hostStart = HostNanoseconds();
+}
+
+static void
+BenchReport(char *name, int threads, int ops)
+{
+    long long ns = HostNanoseconds() - hostStart;
+    int ticks = kernel->stats->totalTicks - tickStart;
+
+    cout << name << "," << threads << "," << ops << "," << ns << ","
+	<< (double) ns / ops << "," << ticks << "," << (double) ticks / ops
+	<< "\n";
+}
+
+//----------------------------------------------------------------------
+// BenchJoin
+// 	Wait until "n" helper threads have finished.  Only called when
+//	the helpers can finish without further help from us.
+//----------------------------------------------------------------------
+
+static void
+BenchJoin(int n)
+{
+    while (benchDone < n) {
+	kernel->currentThread->Yield();
+    }
+}
+
+//----------------------------------------------------------------------
+// Helper threads, one per benchmark.
+//----------------------------------------------------------------------
+
+static void
+ExitThread(void *)
+{
+    benchDone++;
+}
+
+static void
+YieldThread(void *)
+{
+    for (int i = 0; i < benchOps; i++) {
+	kernel->currentThread->Yield();
+    }
+    benchDone++;
+}
+
+static void
+PongThread(void *)
+{
+    for (int i = 0; i < benchOps; i++) {
+	benchPing->P();
+	benchPong->V();
+    }
+    benchDone++;
+}
+
+static void
+LockThread(void *)
+{
+    for (int i = 0; i < benchOps; i++) {
+	benchLock->Acquire();
+	kernel->currentThread->Yield();	// let the others pile up
+	benchLock->Release();
+    }
+    benchDone++;
+}
+
+static void
+FastLockThread(void *)
+{
+    for (int i = 0; i < benchOps; i++) {
+	benchFastLock->Acquire();
+	kernel->currentThread->Yield();
+	benchFastLock->Release();
+    }
+    benchDone++;
+}
+
+static void
+ReaderThread(void *)
+{
+    for (int i = 0; i < benchOps; i++) {
+	benchRWLock->AcquireRead();
+	kernel->currentThread->Yield();	// let the others in beside us
+	benchRWLock->ReleaseRead();
+    }
+    benchDone++;
+}
+
+static void
+WriterThread(void *)
+{
+    for (int i = 0; i < benchOps; i++) {
+	benchRWLock->AcquireWrite();
+	kernel->currentThread->Yield();
+	benchRWLock->ReleaseWrite();
+    }
+    benchDone++;
+}
+
+static void
+WaitThread(void *)
+{
+    benchLock->Acquire();
+    for (int round = 0; round < benchOps; round++) {
+	benchWaits++;
+	while (benchRound == round) {
+	    benchCond->Wait(benchLock);
+	}
+    }
+    benchLock->Release();
+    benchDone++;
+}
+
+static void
+ProducerThread(void *)
+{
+    for (int i = 0; i < benchOps; i++) {
+	benchList->Append(i);
+    }
+    benchDone++;
+}
+
+//----------------------------------------------------------------------
+// SynchBenchmark
+// 	Run the benchmarks, in a fixed order:
+//
+//	fork_finish	Fork a thread that does nothing, and wait for it
+//			to finish.  ops = threads created.
+//	yield		Two threads Yield back and forth.  ops = Yields.
+//	sem_handoff	Two threads pass control through a pair of
+//			semaphores.  ops = round trips (two P's, two V's).
+//	lock_contended	BenchLockers threads each Acquire the lock,
+//			Yield while holding it, and Release it.
+//			ops = Acquire/Release pairs.
+//	cond_broadcast	BenchWaiters threads wait on a condition, which
+//			is broadcast once they are all waiting.
+//			ops = Broadcasts.
+//	synchlist	One thread appends to a SynchList, another takes
+//			items off.  ops = items passed.
+//	lock_uncontended, fastlock_uncontended
+//			Acquire and Release a lock nobody else wants.
+//			ops = Acquire/Release pairs.
+//	fastlock_contended
+//			lock_contended, with a FastLock.
+//	rwlock_read	BenchLockers threads each AcquireRead, Yield while
+//			holding the lock, and ReleaseRead.  ops = read
+//			Acquire/Release pairs.
+//	rwlock_mixed	rwlock_read, plus one thread doing the same as a
+//			writer.  ops = read and write Acquire/Release
+//			pairs.
+//
+//	"iterations" is the number of operations per benchmark (per
+//		helper thread for lock_contended)
+//----------------------------------------------------------------------
+
+void
+SynchBenchmark(int iterations)
+{
+    Thread *t;
+    int i;
+
+    ASSERT(iterations > 0);
+    benchOps = iterations;
+    cout << "benchmark,threads,ops,host_ns,host_ns_per_op,ticks,ticks_per_op\n";
+
+    BenchStart();
+    for (i = 0; i < iterations; i++) {
+	t = new Thread("bench fork");
+	t->Fork(ExitThread, NULL);
+	BenchJoin(i + 1);
+    }
+    BenchReport("fork_finish", 1, iterations);
+
+    BenchStart();
+    t = new Thread("bench yield");
+    t->Fork(YieldThread, NULL);
+    for (i = 0; i < iterations; i++) {
+	kernel->currentThread->Yield();
+    }
+    BenchJoin(1);
+    BenchReport("yield", 1, 2 * iterations);
+
+    benchPing = new Semaphore("bench ping", 0);
+    benchPong = new Semaphore("bench pong", 0);
+    BenchStart();
+    t = new Thread("bench pong");
+    t->Fork(PongThread, NULL);
+    for (i = 0; i < iterations; i++) {
+	benchPing->V();
+	benchPong->P();
+    }
+    BenchJoin(1);
+    BenchReport("sem_handoff", 1, iterations);
+    delete benchPing;
+    delete benchPong;
+
+    benchLock = new Lock("bench lock");
+    BenchStart();
+    for (i = 0; i < BenchLockers; i++) {
+	t = new Thread("bench locker");
+	t->Fork(LockThread, NULL);
+    }
+    BenchJoin(BenchLockers);
+    BenchReport("lock_contended", BenchLockers, BenchLockers * iterations);
+
+    benchCond = new Condition("bench cond");
+    benchRound = 0;
+    benchWaits = 0;
+    BenchStart();
+    for (i = 0; i < BenchWaiters; i++) {
+	t = new Thread("bench waiter");
+	t->Fork(WaitThread, NULL);
+    }
+    for (i = 0; i < iterations; i++) {
+	while (benchWaits < BenchWaiters * (i + 1)) {
+	    kernel->currentThread->Yield();	// not everyone waiting yet
+	}
+	benchLock->Acquire();
+	benchRound++;
+	benchCond->Broadcast(benchLock);
+	benchLock->Release();
+    }
+    BenchJoin(BenchWaiters);
+    BenchReport("cond_broadcast", BenchWaiters, iterations);
+    delete benchCond;
+    delete benchLock;
+
+    benchList = new SynchList<int>;
+    BenchStart();
+    t = new Thread("bench producer");
+    t->Fork(ProducerThread, NULL);
+    for (i = 0; i < iterations; i++) {
+	(void) benchList->RemoveFront();
+    }
+    BenchJoin(1);
+    BenchReport("synchlist", 1, iterations);
+    delete benchList;
+
+    benchLock = new Lock("bench lock");
+    BenchStart();
+    for (i = 0; i < iterations; i++) {
+	benchLock->Acquire();
+	benchLock->Release();
+    }
+    BenchReport("lock_uncontended", 0, iterations);
+    delete benchLock;
+
+    benchFastLock = new FastLock("bench fast lock");
+    BenchStart();
+    for (i = 0; i < iterations; i++) {
+	benchFastLock->Acquire();
+	benchFastLock->Release();
+    }
+    BenchReport("fastlock_uncontended", 0, iterations);
+
+    BenchStart();
+    for (i = 0; i < BenchLockers; i++) {
+	t = new Thread("bench fast locker");
+	t->Fork(FastLockThread, NULL);
+    }
+    BenchJoin(BenchLockers);
+    BenchReport("fastlock_contended", BenchLockers, BenchLockers * iterations);
+    delete benchFastLock;
+
+    benchRWLock = new RWLock("bench rwlock");
+    BenchStart();
+    for (i = 0; i < BenchLockers; i++) {
+	t = new Thread("bench reader");
+	t->Fork(ReaderThread, NULL);
+    }
+    BenchJoin(BenchLockers);
+    BenchReport("rwlock_read", BenchLockers, BenchLockers * iterations);
+
+    BenchStart();
+    for (i = 0; i < BenchLockers; i++) {
+	t = new Thread("bench reader");
+	t->Fork(ReaderThread, NULL);
+    }
+    t = new Thread("bench writer");
+    t->Fork(WriterThread, NULL);
+    BenchJoin(BenchLockers + 1);
+    BenchReport("rwlock_mixed", BenchLockers + 1,
+		(BenchLockers + 1) * iterations);
+    delete benchRWLock;
+}
@@ -0,0 +1,18 @@
+// synchbench.h
+//	Micro-benchmarks for thread creation, context switching and
+//	the synchronization primitives, run with "nachos -bench".
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SYNCHBENCH_H
+#define SYNCHBENCH_H
+
+#include "copyright.h"
+
+// Run every benchmark "iterations" times and print one CSV line per
+// benchmark to cout, after a header line.
+extern void SynchBenchmark(int iterations);
+
+#endif // SYNCHBENCH_H
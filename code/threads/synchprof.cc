@@ -0,0 +1,137 @@
+// synchprof.cc
+//	Routines to collect and report lock contention.  See synchprof.h.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "main.h"
+#include "synchprof.h"
+#include <vector>
+#include <algorithm>
+
+//----------------------------------------------------------------------
+// SynchProfile::SynchProfile
+// 	Start with nothing recorded.
+//----------------------------------------------------------------------
+
+SynchProfile::SynchProfile(const char *objKind, const char *objName)
+{
+    kind = objKind;
+    name = objName;
+    acquires = contended = 0;
+    waitTicks = holdTicks = 0;
+    maxWait = maxHold = 0;
+    queued = maxQueue = 0;
+}
+
+//----------------------------------------------------------------------
+// SynchProfile::StartWait, SynchProfile::EndWait
+// 	Bracket the time a thread spends blocked.  The queue length is
+//	summed over all the objects sharing this name.
+//
+//	"since" -- what StartWait returned
+//----------------------------------------------------------------------
+
+long long
+SynchProfile::StartWait()
+{
+    if (++queued > maxQueue)
+	maxQueue = queued;
+    return kernel->stats->totalTicks;
+}
+
+void
+SynchProfile::EndWait(long long since)
+{
+    int waited = kernel->stats->totalTicks - since;
+
+    queued--;
+    acquires++;
+    contended++;
+    waitTicks += waited;
+    if (waited > maxWait)
+	maxWait = waited;
+}
+
+void
+SynchProfile::Held(int ticks)
+{
+    holdTicks += ticks;
+    if (ticks > maxHold)
+	maxHold = ticks;
+}
+
+//----------------------------------------------------------------------
+// SynchProfiler::~SynchProfiler
+//----------------------------------------------------------------------
+
+SynchProfiler::~SynchProfiler()
+{
+    std::map<std::string, SynchProfile *>::iterator it;
+
+    for (it = profiles.begin(); it != profiles.end(); it++)
+	delete it->second;
+}
+
+//----------------------------------------------------------------------
+// SynchProfiler::Find
+// 	Return the profile for objects of "kind" called "name".  Objects
+//	with no name share one profile.
+//----------------------------------------------------------------------
+
+SynchProfile *
+SynchProfiler::Find(const char *kind, char *name)
+{
+    std::string key = std::string(kind) + " " + (name != NULL ? name : "");
+    SynchProfile *&p = profiles[key];
+
+    if (p == NULL)
+	p = new SynchProfile(kind, name != NULL ? name : "");
+    return p;
+}
+
+//----------------------------------------------------------------------
+// MoreContended
+// 	Rank profiles by total wait, then by contended acquires.
+//----------------------------------------------------------------------
+
+static bool
+MoreContended(SynchProfile *a, SynchProfile *b)
+{
+    if (a->waitTicks != b->waitTicks)
+	return a->waitTicks > b->waitTicks;
+    return a->contended > b->contended;
+}
+
+//----------------------------------------------------------------------
+// SynchProfiler::Print
+// 	Print one line per object name that was ever acquired, the ones
+//	threads waited on longest first.
+//----------------------------------------------------------------------
+
+void
+SynchProfiler::Print()
+{
+    std::vector<SynchProfile *> ranked;
+    std::map<std::string, SynchProfile *>::iterator it;
+
+    for (it = profiles.begin(); it != profiles.end(); it++) {
+	if (it->second->acquires > 0)
+	    ranked.push_back(it->second);
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), MoreContended);
+
+    printf("Contention: %d synchronization objects used\n", (int) ranked.size());
+    printf("%-10s %-24s %9s %9s %11s %8s %11s %8s %6s\n", "kind", "name",
+	"acquires", "contended", "wait", "max_wait", "hold", "max_hold",
+	"max_q");
+    for (unsigned int i = 0; i < ranked.size(); i++) {
+	SynchProfile *p = ranked[i];
+
+	printf("%-10s %-24s %9d %9d %11lld %8d %11lld %8d %6d\n", p->kind,
+	    p->name.c_str(), p->acquires, p->contended, p->waitTicks, p->maxWait,
+	    p->holdTicks, p->maxHold, p->maxQueue);
+    }
+}
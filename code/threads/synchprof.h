@@ -0,0 +1,66 @@
+// synchprof.h
+//	Contention profiling for locks (including FastLocks and
+//	RWLocks), semaphores and condition variables, turned on with
+//	"nachos -lockprof".
+//
+//	Statistics are kept per kind of object and debug name, so all
+//	the locks called "list lock" (one per SynchList) share one
+//	entry.  Each object looks its entry up once, when it is
+//	created; with profiling off it gets NULL, and records nothing.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SYNCHPROF_H
+#define SYNCHPROF_H
+
+#include "copyright.h"
+#include <map>
+#include <string>
+
+// What happened to every object of one kind with one name.  All times
+// are in ticks.  For a condition variable, an "acquire" is a Wait, and
+// the wait is the time until it was signalled.
+
+class SynchProfile {
+  public:
+    SynchProfile(const char *objKind, const char *objName);
+
+    long long StartWait();	// about to block; returns the time
+    void EndWait(long long since);
+				// got it after blocking since "since"
+    void Acquired()		{ acquires++; }
+				// got it without blocking
+    void Held(int ticks);	// a lock was held this long
+
+    const char *kind;		// "Lock", "FastLock", "RWLock",
+				// "Semaphore" or "Condition"
+    std::string name;		// a copy; the object may be gone by
+				// the time the report is printed
+    int acquires;		// including contended ones
+    int contended;		// acquires that had to wait
+    long long waitTicks;
+    int maxWait;
+    long long holdTicks;	// locks only; for an RWLock, writers
+    int maxHold;
+    int queued;			// threads waiting right now
+    int maxQueue;
+};
+
+// All the profiles, printed at halt, worst first.
+
+class SynchProfiler {
+  public:
+    SynchProfiler() {}
+    ~SynchProfiler();
+
+    SynchProfile *Find(const char *kind, char *name);
+				// the entry for "name", created if need be
+    void Print();		// the contention report
+
+  private:
+    std::map<std::string, SynchProfile *> profiles;
+};
+
+#endif // SYNCHPROF_H
@@ -25,6 +25,34 @@
 // this is put at the top of the execution stack, for detecting stack overflows
 const int STACK_FENCEPOST = 0xdedbeef;
 
+//----------------------------------------------------------------------
+// Thread::operator new, Thread::operator delete
+// 	Deleted thread control blocks are kept on a free list, chained
+//	through their first word, and handed out by the next "new Thread"
+//	instead of going back to the host heap.
+//----------------------------------------------------------------------
+
+static void *freeThreads = NULL;
+
+void *
+Thread::operator new(size_t size)
+{
+    void *t = freeThreads;
+
+    if (size != sizeof(Thread) || t == NULL) {
+	return ::operator new(size);
+    }
+    freeThreads = *(void **) t;
+    return t;
+}
+
+void
+Thread::operator delete(void *p)
+{
+    *(void **) p = freeThreads;
+    freeThreads = p;
+}
+
 //----------------------------------------------------------------------
 // Thread::Thread
 // 	Initialize a thread control block, so that we can then call
@@ -39,6 +67,26 @@ Thread::Thread(char* threadName)
     stackTop = NULL;
     stack = NULL;
     status = JUST_CREATED;
+    metrics.name = threadName;
+    metrics.created = kernel->stats->totalTicks;
+    metrics.firstRun = -1;
+    metrics.finished = -1;
+    metrics.lastChange = metrics.created;
+    metrics.readyTicks = metrics.runTicks = metrics.blockedTicks = 0;
+    metrics.switches = 0;
+    burstTime = 0;
+    predictedBurst = -1;
+    priority = basePriority = 0;
+    donated = NoDonation;
+    waitingOn = NULL;
+    heldLocks = NULL;
+    level = 0;
+    quantumLeft = 0;
+    boostEpoch = -1;		// not yet seen by the MLFQ scheduler
+    tickets = DefaultTickets;
+    pass = 0;			// caught up to the others when first ready
+    readySeq = 0;
+    realTime = NULL;
     for (int i = 0; i < MachineStateSize; i++) {
 	machineState[i] = NULL;		// not strictly necessary, since
 					// new thread ignores contents 
@@ -67,7 +115,7 @@ Thread::~Thread()
 
     ASSERT(this != kernel->currentThread);
     if (stack != NULL)
-	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+	FreePooledArray((char *) stack, StackSize * sizeof(int));
 }
 
 //----------------------------------------------------------------------
@@ -97,7 +145,7 @@ Thread::Fork(VoidFunctionPtr func, void *arg)
     Scheduler *scheduler = kernel->scheduler;
     IntStatus oldLevel;
     
-    DEBUG(dbgThread, "Forking thread: " << name << " f(a): " << (int) func << " " << arg);
+    DEBUG(dbgThread, "Forking thread: " << name << " f(a): " << (void *) func << " " << arg);
     
     StackAllocate(func, arg);
 
@@ -105,7 +153,43 @@ Thread::Fork(VoidFunctionPtr func, void *arg)
     scheduler->ReadyToRun(this);	// ReadyToRun assumes that interrupts 
 					// are disabled!
     (void) interrupt->SetLevel(oldLevel);
-}    
+}
+
+//----------------------------------------------------------------------
+// Thread::setStatus
+// 	Change the thread's status, charging the time since the last
+//	change to the status it is leaving.
+//
+//	"st" -- the new status
+//----------------------------------------------------------------------
+
+void
+Thread::setStatus(ThreadStatus st)
+{
+    long long now = kernel->stats->totalTicks;
+    long long spent = now - metrics.lastChange;
+
+    switch (status) {
+      case READY:
+	metrics.readyTicks += spent;
+	break;
+      case RUNNING:
+	metrics.runTicks += spent;
+	break;
+      case BLOCKED:
+	metrics.blockedTicks += spent;
+	break;
+      default:				// JUST_CREATED
+	break;
+    }
+    if (st == RUNNING) {
+	if (metrics.firstRun < 0)
+	    metrics.firstRun = now;
+	metrics.switches++;
+    }
+    metrics.lastChange = now;
+    status = st;
+}
 
 //----------------------------------------------------------------------
 // Thread::CheckOverflow
@@ -248,9 +332,14 @@ Thread::Sleep (bool finishing)
     
     DEBUG(dbgThread, "Sleeping thread: " << name);
 
-    status = BLOCKED;
-    while ((nextThread = kernel->scheduler->FindNextToRun()) == NULL)
-	kernel->interrupt->Idle();	// no one to run, wait for an interrupt
+    setStatus(BLOCKED);
+    kernel->scheduler->Blocked(this, finishing);
+    if ((nextThread = kernel->scheduler->FindNextToRun()) == NULL) {
+	do {
+	    kernel->interrupt->Idle();	// no one to run, wait for an interrupt
+	} while ((nextThread = kernel->scheduler->FindNextToRun()) == NULL);
+	kernel->alarm->LeaveIdle();	// time slicing again
+    }
     
     // returns when it's time for us to run
     kernel->scheduler->Run(nextThread, finishing); 
@@ -307,7 +396,7 @@ PLabelToAddr(void *plabel)
 void
 Thread::StackAllocate (VoidFunctionPtr func, void *arg)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(int));
+    stack = (int *) AllocPooledArray(StackSize * sizeof(int));
 
 #ifdef PARISC
     // HP stack works from low addresses to high addresses
@@ -347,6 +436,14 @@ Thread::StackAllocate (VoidFunctionPtr func, void *arg)
     *(--stackTop) = (int) ThreadRoot;
     *stack = STACK_FENCEPOST;
 #endif
+
+#ifdef X86_64
+    // SWITCH jumps to the saved pc rather than returning through the
+    // stack, so all ThreadRoot needs is an empty stack; it aligns the
+    // stack pointer itself.
+    stackTop = stack + StackSize - 4;	// -4 to be on the safe side!
+    *stack = STACK_FENCEPOST;
+#endif
     
 #ifdef PARISC
     machineState[PCState] = PLabelToAddr(ThreadRoot);
@@ -420,6 +517,91 @@ SimpleThread()
     }    
 }
 
+//----------------------------------------------------------------------
+// PeriodicThread
+// 	A real-time thread for the EDF test: run "jobs" jobs, each of
+//	"work" ticks of CPU, except for one job that runs "overrun"
+//	ticks, to show the budget being enforced.
+//----------------------------------------------------------------------
+
+class PeriodicTask {
+  public:
+    char *name;
+    int period, budget;
+    int work, overrun;		// ticks of CPU per job, and for job 2
+    int jobs;
+    bool admitted;		// what the test expects
+    int misses, overruns;
+};
+
+static void
+PeriodicThread(PeriodicTask *task)
+{
+    for (int job = 0; job < task->jobs; job++) {
+	int work = (job == 2) ? task->overrun : task->work;
+
+	printf("%s: job %d at %lld\n", task->name, job,
+			kernel->stats->totalTicks);
+	for (int i = 0; i < work; i += SystemTick)
+	    kernel->interrupt->OneTick();
+	kernel->scheduler->EndJob();
+    }
+}
+
+static PeriodicTask periodic[] = {
+    { "A", 400, 100, 80, 80, 6, TRUE, 0, 0 },
+    { "B", 600, 200, 150, 400, 4, TRUE, 1, 2 },	// job 2 overruns
+    { "C", 1200, 350, 300, 300, 2, TRUE, 0, 0 },
+    { "D", 500, 200, 100, 100, 4, FALSE, 0, 0 },	// does not fit
+};
+
+//----------------------------------------------------------------------
+// EDFSelfTest
+// 	Admit the periodic threads above, as far as they fit, and let
+//	them run.  Only D must be rejected.  Every job of the others must
+//	meet its deadline, except that B's overrun costs it two budgets
+//	and makes it late once.  The lateness of each job is reported at
+//	halt, with -metrics.
+//
+//	The scheduler keeps the RTTask of a thread after it finishes, so
+//	we can check the counts once all the jobs are done.
+//----------------------------------------------------------------------
+
+static void
+EDFSelfTest()
+{
+    const int n = sizeof(periodic) / sizeof(periodic[0]);
+    RTTask *tasks[n];
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    for (int i = 0; i < n; i++) {
+	Thread *t = new Thread(periodic[i].name);
+	bool admitted = kernel->scheduler->SetRealTime(t, periodic[i].period,
+							periodic[i].budget);
+
+	ASSERT(admitted == periodic[i].admitted);
+	if (!admitted) {
+	    printf("%s: rejected\n", periodic[i].name);
+	    tasks[i] = NULL;
+	    delete t;
+	    continue;
+	}
+	tasks[i] = t->getRealTime();
+	t->Fork((VoidFunctionPtr) PeriodicThread, (void *) &periodic[i]);
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+
+    for (int i = 0; i < n; i++) {	// we only run when they don't
+	if (tasks[i] == NULL)
+	    continue;
+	while (tasks[i]->jobs < periodic[i].jobs)
+	    kernel->alarm->WaitUntil(1);
+	ASSERT(tasks[i]->misses == periodic[i].misses);
+	ASSERT(tasks[i]->overruns == periodic[i].overruns);
+    }
+    printf("EDFSelfTest: passed\n");
+}
+
 //----------------------------------------------------------------------
 // Thread::SelfTest
 // 	Set up a ping-pong between two threads, by forking a thread 
@@ -430,11 +612,17 @@ void
 Thread::SelfTest() // SJF SRTF 使用
 {
     DEBUG(dbgThread, "Entering Thread::SelfTest");
+
+    if (kernel->scheduler->getSchedulerType() == EDF) {
+	EDFSelfTest();
+	return;
+    }
     
     const int number 	 = 3;
     char *name[number] 	 = {"A", "B", "C"};
     int burst[number] 	 = {3, 20, 4};
     int priority[number] = {4, 5, 3};
+    int tickets[number]  = {100, 300, 200};	// Stride, Lottery
     
     Thread *t;
     for (int i = 0; i < number; i ++) {
@@ -443,6 +631,7 @@ Thread::SelfTest() // SJF SRTF 使用
         t = new Thread(name[i]);
         t->setPriority(priority[i]);
         t->setBurstTime(burst[i]);
+        t->setTickets(tickets[i]);
         t->Fork((VoidFunctionPtr) SimpleThread, (void *)NULL);
     }
 
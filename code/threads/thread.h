@@ -52,9 +52,15 @@
 // SPARC and MIPS needs to save 10 registers, 
 // the Snake needs 18,
 // and the RS6000 needs to save 75 (!)
-// For simplicity, I just take the maximum over all architectures.
+// For simplicity, I just take the maximum over all architectures,
+// except on x86-64, which saves just its 7 callee-saved registers
+// and pc, and gets a smaller Thread in return.
 
+#ifdef X86_64
+#define MachineStateSize 7
+#else
 #define MachineStateSize 75 
+#endif
 
 
 // Size of the thread's private execution stack.
@@ -62,10 +68,34 @@
 const int StackSize = (4 * 1024);	// in words
 
 
+// A thread's priority when no one is donating to it.  Smaller
+// priorities run first, so this is larger than any real priority.
+const int NoDonation = 0x7fffffff;
+
+class Lock;
+class RTTask;
+
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
 
 
+// The scheduling history of a thread, in ticks.  Kept up to date by
+// Thread::setStatus; when the thread finishes, the scheduler keeps a
+// copy for the report printed at halt (see Scheduler::PrintMetrics).
+
+class ThreadMetrics {
+  public:
+    char *name;
+    long long created;		// when the thread was created
+    long long firstRun;		// when it first got the CPU; -1 if never
+    long long finished;		// when it finished; -1 if it hasn't
+    long long lastChange;	// when its status last changed
+    long long readyTicks;	// time on the ready list (waiting time)
+    long long runTicks;		// time holding the CPU
+    long long blockedTicks;	// time blocked
+    int switches;		// times the CPU was switched to it
+};
+
 // The following class defines a "thread control block" -- which
 // represents a single thread of execution.
 //
@@ -91,6 +121,9 @@ class Thread {
 					// must not be running when delete 
 					// is called
 
+    void *operator new(size_t size);	// control blocks are recycled
+    void operator delete(void *p);	// through a free list
+
     // basic thread operations
 
     void Fork(VoidFunctionPtr func, void *arg); 
@@ -103,13 +136,44 @@ class Thread {
     void Finish();  		// The thread is done executing
     
     void CheckOverflow();   	// Check if thread stack has overflowed
-    void setStatus(ThreadStatus st) { status = st; }
+    void setStatus(ThreadStatus st);	// also updates our metrics
+    ThreadMetrics *getMetrics()	{return &metrics;}
     void setBurstTime(int t)	{burstTime = t;}
     int getBurstTime()		{return burstTime;}
-    void setPriority(int t)	{priority = t;}
+    void setPredictedBurst(int t) {predictedBurst = t;}
+    int getPredictedBurst()	{return predictedBurst;}
+    int getExpectedBurst()	{return predictedBurst >= 0 ? predictedBurst : burstTime;}
+    				// what SJF/SRTF sort on: the measured
+				// prediction if there is one, else the
+				// hand-set burst time
+    void setPriority(int t)	{basePriority = t; priority = min(t, donated);}
     int getPriority()		{return priority;}
+    int getBasePriority()	{return basePriority;}
+    void setDonatedPriority(int t) {donated = t; priority = min(basePriority, t);}
+    				// priority inherited through the locks
+				// we hold; NoDonation if none.  Use
+				// Scheduler::Donate for a ready thread
+    void setWaitingOn(Lock *l)	{waitingOn = l;}
+    Lock *getWaitingOn()	{return waitingOn;}
+    void setHeldLocks(Lock *l)	{heldLocks = l;}
+    Lock *getHeldLocks()	{return heldLocks;}
     void setStartTime(int t)	{startTime = t;}
     int getStartTime()		{return startTime;}
+    void setLevel(int l)	{level = l;}
+    int getLevel()		{return level;}
+    void setQuantumLeft(int q)	{quantumLeft = q;}
+    int getQuantumLeft()	{return quantumLeft;}
+    void setBoostEpoch(int e)	{boostEpoch = e;}
+    int getBoostEpoch()		{return boostEpoch;}
+    void setTickets(int t)	{tickets = t;}
+    int getTickets()		{return tickets;}
+    void setPass(long long p)	{pass = p;}
+    long long getPass()		{return pass;}
+    void setReadySeq(int s)	{readySeq = s;}
+    int getReadySeq()		{return readySeq;}
+    void setRealTime(RTTask *r)	{realTime = r;}
+    RTTask *getRealTime()	{return realTime;}
+    ThreadStatus getStatus()	{return status;}
     char* getName() { return (name); }
     void Print() { cout << name; }
     static void SelfTest();		// test whether thread impl is working
@@ -123,8 +187,24 @@ class Thread {
     ThreadStatus status;	// ready, running or blocked
     char* name;
     int burstTime;
+    int predictedBurst;	// next CPU burst, by exponential averaging
+			// of past bursts; -1 if not predicting
     int startTime;	// the start time of the thread
-    int priority;	
+    int priority;	// effective: the better of the two below
+    int basePriority;	// as set by setPriority
+    int donated;	// best priority of a thread waiting on a
+			// lock we hold (Priority scheduler only)
+    Lock *waitingOn;	// lock we are blocked on in Lock::Acquire
+    Lock *heldLocks;	// locks we hold, chained through Lock::nextHeld
+    ThreadMetrics metrics;
+    int level;		// MLFQ: current feedback queue level
+    int quantumLeft;	// MLFQ: timer interrupts left at this level
+    int boostEpoch;	// MLFQ: last priority boost applied to us
+    int tickets;	// Stride/Lottery: share of the CPU
+    long long pass;	// Stride: CPU used, scaled by 1/tickets
+    int readySeq;	// Stride, EDF: when we joined the ready heap
+    RTTask *realTime;	// EDF: period, budget and deadline; NULL
+			// if we are not a real-time thread
     void StackAllocate(VoidFunctionPtr func, void *arg);
     				// Allocate a stack for thread.
 				// Used internally by Fork()
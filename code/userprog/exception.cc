@@ -59,6 +59,9 @@ ExceptionHandler(ExceptionType which)
 	    switch(type) {
 		case SC_Halt:
 		    DEBUG(dbgAddr, "Shutdown, initiated by user program.\n");
+#ifdef FILESYS
+		    kernel->fileSystem->Sync();	// don't lose cached writes
+#endif
    		    kernel->interrupt->Halt();
 		    break;
 		case SC_PrintInt:
@@ -70,6 +73,14 @@ ExceptionHandler(ExceptionType which)
     		cout << "Sleep Time " << val << "(ms) " << endl;
     		kernel->alarm->WaitUntil(val);
     		return;
+		case SC_SetTickets:
+			val=kernel->machine->ReadRegister(4);
+			{
+			IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+			kernel->scheduler->SetTickets(kernel->currentThread, val);
+			(void) kernel->interrupt->SetLevel(oldLevel);
+			}
+			return;
 /*		case SC_Exec:
 			DEBUG(dbgAddr, "Exec\n");
 			val = kernel->machine->ReadRegister(4);
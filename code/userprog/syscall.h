@@ -31,6 +31,7 @@
 #define SC_ThreadYield	10
 #define SC_PrintInt	11
 #define SC_Sleep	12
+#define SC_SetTickets	13
 
 #ifndef IN_ASM
 
@@ -132,6 +133,11 @@ void PrintInt(int number);	//my System Call
 
 void Sleep(int number);
 
+/* Set the number of tickets, i.e. the share of the CPU, the calling
+ * thread gets under the -STRIDE and -LOTTERY schedulers.
+ */
+void SetTickets(int tickets);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
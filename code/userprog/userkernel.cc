@@ -10,6 +10,12 @@
 #include "synchconsole.h"
 #include "userkernel.h"
 #include "synchdisk.h"
+#ifdef FILESYS
+#include "bufcache.h"
+#include "fscache.h"
+
+extern void JournalCrashTest(), JournalReplayTest(), FileSysSelfTest();
+#endif
 
 //----------------------------------------------------------------------
 // UserProgKernel::UserProgKernel
@@ -21,6 +27,9 @@ UserProgKernel::UserProgKernel(int argc, char **argv)
 		: ThreadedKernel(argc, argv)
 {
     debugUserProg = FALSE;
+    diskSchedType = DiskFCFS;
+    formatDisk = TRUE;
+    journalCrash = journalReplay = fileSysTest = FALSE;
 	execfileNum=0;
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-s") == 0) {
@@ -32,11 +41,41 @@ UserProgKernel::UserProgKernel(int argc, char **argv)
 		else if(strcmp(argv[i], "-prio") == 0){ 
 			// to-do，can make userkernel SJF
 		}
+		else if (strcmp(argv[i], "-disk") == 0) {
+			ASSERT(i + 1 < argc);	// next argument is the policy
+			i++;
+			if (strcmp(argv[i], "FCFS") == 0)
+				diskSchedType = DiskFCFS;
+			else if (strcmp(argv[i], "SSTF") == 0)
+				diskSchedType = DiskSSTF;
+			else if (strcmp(argv[i], "SCAN") == 0)
+				diskSchedType = DiskSCAN;
+			else if (strcmp(argv[i], "CLOOK") == 0)
+				diskSchedType = DiskCLOOK;
+			else
+				cout << "Unknown disk policy " << argv[i] << ", using FCFS\n";
+		}
+		else if (strcmp(argv[i], "-mount") == 0) {
+			formatDisk = FALSE;	// keep what is on the disk
+		}
+		else if (strcmp(argv[i], "-fscrash") == 0) {
+			journalCrash = TRUE;
+		}
+		else if (strcmp(argv[i], "-fstest") == 0) {
+			fileSysTest = TRUE;
+		}
+		else if (strcmp(argv[i], "-fsreplay") == 0) {
+			journalReplay = TRUE;	// check what -fscrash left
+			formatDisk = FALSE;
+		}
     	else if (strcmp(argv[i], "-u") == 0) {
 			cout << "===========The following argument is defined in userkernel.cc" << endl;
 			cout << "Partial usage: nachos [-s]\n";
 			cout << "Partial usage: nachos [-u]" << endl;
 			cout << "Partial usage: nachos [-e] filename" << endl;
+			cout << "Partial usage: nachos [-disk FCFS|SSTF|SCAN|CLOOK]" << endl;
+			cout << "Partial usage: nachos [-mount]" << endl;
+			cout << "Partial usage: nachos [-fstest] [-fscrash] [-fsreplay]" << endl;
 		}
 		else if (strcmp(argv[i], "-h") == 0) {
 			cout << "argument 's' is for debugging. Machine status  will be printed " << endl;
@@ -60,11 +99,13 @@ UserProgKernel::Initialize()
     ThreadedKernel::Initialize();	// init multithreading
 
     machine = new Machine(debugUserProg);
-    fileSystem = new FileSystem();
-	vm_Disk = new SynchDisk("New Disk");//to save the page which the main memoey don't have enough memory to save
 #ifdef FILESYS
-    synchDisk = new SynchDisk("New SynchDisk");
+    synchDisk = new SynchDisk("New SynchDisk", diskSchedType);
+    bufferCache = new BufferCache(synchDisk);
+    inodeCache = new InodeCache();
 #endif // FILESYS
+    fileSystem = new FileSystem(formatDisk);
+	vm_Disk = new SynchDisk("New Disk", diskSchedType);//to save the page which the main memoey don't have enough memory to save
 }
 
 void
@@ -72,11 +113,13 @@ UserProgKernel::Initialize(SchedulerType type)
 {
     ThreadedKernel::Initialize(type);	// init multithreading
     machine = new Machine(debugUserProg);
-    fileSystem = new FileSystem();
-	vm_Disk = new SynchDisk("New Disk");//to save the page which the main memoey don't have enough memory to save
 #ifdef FILESYS
-    synchDisk = new SynchDisk("New SynchDisk");
+    synchDisk = new SynchDisk("New SynchDisk", diskSchedType);
+    bufferCache = new BufferCache(synchDisk);
+    inodeCache = new InodeCache();
 #endif // FILESYS
+    fileSystem = new FileSystem(formatDisk);
+	vm_Disk = new SynchDisk("New Disk", diskSchedType);//to save the page which the main memoey don't have enough memory to save
 }
 
 //----------------------------------------------------------------------
@@ -90,6 +133,8 @@ UserProgKernel::~UserProgKernel()
     delete fileSystem;
     delete machine;
 #ifdef FILESYS
+    delete inodeCache;
+    delete bufferCache;
     delete synchDisk;
 #endif
 }
@@ -166,4 +211,12 @@ UserProgKernel::SelfTest() {
 
 
 //	cout << "This is self test message from UserProgKernel\n" ;
+#ifdef FILESYS
+    if (fileSysTest)
+	FileSysSelfTest();
+    if (journalReplay)
+	JournalReplayTest();
+    if (journalCrash)
+	JournalCrashTest();	// halts the machine
+#endif
 }
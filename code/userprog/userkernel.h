@@ -17,6 +17,8 @@
 #include "machine.h"
 #include "synchdisk.h"
 class SynchDisk;
+class BufferCache;
+class InodeCache;
 class UserProgKernel : public ThreadedKernel {
   public:
     UserProgKernel(int argc, char **argv);
@@ -34,8 +36,19 @@ class UserProgKernel : public ThreadedKernel {
     Machine *machine;
     FileSystem *fileSystem;
     bool debugUserProg;
+    DiskSchedType diskSchedType;	// order queued disk requests are
+					// served in (-disk)
+    bool formatDisk;			// start with an empty file system,
+					// rather than mount the disk (-mount)
+    bool journalCrash;			// create files, then halt without
+					// syncing (-fscrash)
+    bool journalReplay;			// count the files that survived
+					// (-fsreplay)
+    bool fileSysTest;			// run FileSysSelfTest (-fstest)
 #ifdef FILESYS
     SynchDisk *synchDisk;
+    BufferCache *bufferCache;	// all file system I/O goes through this
+    InodeCache *inodeCache;	// file headers in use, or used recently
 #endif // FILESYS
 
   private: